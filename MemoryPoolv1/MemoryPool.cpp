@@ -1,4 +1,6 @@
 #include "MemoryPool.h"
+#include <cstdlib>
+#include <new>
 
 namespace MemoryPoolv1 {
 MemoryPool::MemoryPool(size_t BlockSize)
@@ -8,19 +10,19 @@ MemoryPool::MemoryPool(size_t BlockSize)
     , curSlot_(nullptr)
     , freeList_(nullptr)
     , lastSlot_(nullptr) 
-    {}
+    , idleWatermark_(0)
+    {
+        // 内存块按自身大小对齐，要求 BlockSize 为 2 的幂
+        assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0);
+    }
 
 MemoryPool::~MemoryPool() {
     // 把连续的block删除
-    Slot* cur = firstBlock_;
+    Block* cur = firstBlock_;
     while(cur) {
-        Slot* next = cur->next;
-        // 等同于 free(reinterpret_cast<void*>(firstBlock_));
-        // 转化为 void 指针，因为 void 类型不需要调用析构函数，只释放空间
-        // 在 C++ 中，operator delete 需要的是一个 void* 类型的指针，而不是特定类型的指针。因此，我们需要将 cur 从 Slot* 类型转换为 void* 类型，这样才能传递给 operator delete。
-        // operator delete 是一个低级别的内存释放操作符，通常与 operator new 配对使用。
-        // delete 是一个更高级的操作符，通常与 new 配对使用。它不仅释放内存，还会调用对象的析构函数。
-        operator delete(reinterpret_cast<void*>(cur));
+        Block* next = cur->next;
+        // 内存块由 posix_memalign 分配，需用 free 释放
+        free(reinterpret_cast<void*>(cur));
         cur = next;
     }
 }
@@ -34,48 +36,131 @@ void MemoryPool::init(size_t size) {
     lastSlot_ = nullptr;
 }
 
-void* MemoryPool::allocate() {
-    // 优先使用空闲链表中的内存槽
-    Slot* slot = popFreeList();
-    if(slot != nullptr) {
-        return slot;
+// 空闲链表为空时，从当前内存块中切出一个未使用过的槽
+Slot* MemoryPool::allocateFromBlock() {
+    std::lock_guard<std::mutex> lock(mutexForBlock_);
+    if(curSlot_ >= lastSlot_) {
+        // 当前内存块已无内存槽可用，开辟一块新的内存
+        allocateNewBlock();
     }
 
-    Slot* temp;
-    {
-        std::lock_guard<std::mutex> lock(mutexForBlock_);
-        if(curSlot_ >= lastSlot_) {
-            // 当前内存块已无内存槽可用，开辟一块新的内存
-            allocateNewBlock();
-        }
+    Slot* slot = curSlot_;
+    // 这里不能直接 curSlot_ += SlotSize_ 因为curSlot_是Slot*类型，所以需要除以SlotSize_再加1
+    curSlot_ += SlotSize_ / sizeof(Slot);
+    return slot;
+}
+
+size_t MemoryPool::shrink() {
+    std::lock_guard<std::mutex> lock(mutexForBlock_);
+    return freeBlocks(detachIdleBlocks(0, 0));
+}
 
-        temp = curSlot_;
-        // 这里不能直接 curSlot_ += SlotSize_ 因为curSlot_是Slot*类型，所以需要除以SlotSize_再加1
-        curSlot_ += SlotSize_ / sizeof(Slot);
+size_t MemoryPool::trim() {
+    std::lock_guard<std::mutex> lock(mutexForBlock_);
+    if(idleWatermark_ == 0) {
+        return 0;
+    }
+    return freeBlocks(detachIdleBlocks(idleWatermark_, idleWatermark_ / 2));
+}
+
+Block* MemoryPool::detachIdleBlocks(size_t threshold, size_t keep) {
+    // 取下整个空闲链表
+    Slot* slots = freeList_.exchange(nullptr, std::memory_order_acquire);
+
+    // 1. 统计每个内存块在空闲链表中的槽数
+    for(Block* block = firstBlock_; block; block = block->next) {
+        block->freeSlots = 0;
+    }
+    for(Slot* cur = slots; cur; cur = cur->next.load(std::memory_order_relaxed)) {
+        ++blockOf(cur)->freeSlots;
     }
 
-    return temp;
+    // 2. 从内存块链表中摘下多余的空闲内存块，当前正在切分的内存块（firstBlock_）保留
+    // 摘下的内存块 freeSlots 置为 SIZE_MAX 作为标记
+    Block* detached = nullptr;
+    size_t idle = 0;
+    if(firstBlock_) {
+        for(Block* block = firstBlock_->next; block; block = block->next) {
+            idle += block->freeSlots == block->slotCount;
+        }
+    }
+    if(idle > threshold) {
+        size_t toDetach = idle - keep;
+        Block* prev = firstBlock_;
+        while(toDetach > 0) {
+            Block* block = prev->next;
+            if(block->freeSlots == block->slotCount) {
+                prev->next = block->next;
+                block->freeSlots = SIZE_MAX;
+                block->next = detached;
+                detached = block;
+                --toDetach;
+            } else {
+                prev = block;
+            }
+        }
+    }
+
+    // 3. 其余槽放回空闲链表
+    Slot* keptHead = nullptr;
+    Slot* keptTail = nullptr;
+    Slot* cur = slots;
+    while(cur) {
+        Slot* next = cur->next.load(std::memory_order_relaxed);
+        if(blockOf(cur)->freeSlots != SIZE_MAX) {
+            cur->next.store(keptHead, std::memory_order_relaxed);
+            keptHead = cur;
+            if(!keptTail) {
+                keptTail = cur;
+            }
+        }
+        cur = next;
+    }
+    if(keptHead) {
+        Slot* oldHead = freeList_.load(std::memory_order_relaxed);
+        do {
+            keptTail->next.store(oldHead, std::memory_order_relaxed);
+        } while(!freeList_.compare_exchange_weak(oldHead, keptHead, std::memory_order_release, std::memory_order_relaxed));
+    }
+    return detached;
 }
 
-void MemoryPool::deallocate(void* ptr) {
-    if(!ptr) {
-        return;
+size_t MemoryPool::freeBlocks(Block* block) {
+    size_t count = 0;
+    while(block) {
+        Block* next = block->next;
+        free(reinterpret_cast<void*>(block));
+        block = next;
+        ++count;
     }
-    Slot* slot = reinterpret_cast<Slot*>(ptr);
-    pushFreeList(slot);
+    return count;
+}
+
+void MemoryPool::setIdleWatermark(size_t watermark) {
+    std::lock_guard<std::mutex> lock(mutexForBlock_);
+    idleWatermark_ = watermark;
 }
 
 void MemoryPool::allocateNewBlock() {
     //std::cout << "申请一块内存块，SlotSize: " << SlotSize_ << std::endl;
+    // 按 BlockSize_ 对齐申请内存块，便于由槽地址反查所属内存块
+    void* newBlock = nullptr;
+    if(posix_memalign(&newBlock, BlockSize_, BlockSize_) != 0) {
+        throw std::bad_alloc();
+    }
+
     // 头插法插入新的内存块
-    void* newBlock = operator new(BlockSize_);
-    reinterpret_cast<Slot*>(newBlock)->next = firstBlock_;
-    firstBlock_ = reinterpret_cast<Slot*>(newBlock);
+    Block* block = reinterpret_cast<Block*>(newBlock);
+    block->owner = this;
+    block->next = firstBlock_;
+    firstBlock_ = block;
 
-    char* body = reinterpret_cast<char*>(newBlock) + sizeof(Slot*);
+    char* body = reinterpret_cast<char*>(newBlock) + sizeof(Block);
     // 计算对齐需要填充内存的大小
     size_t paddingSize = padPointer(body, SlotSize_);
     curSlot_ = reinterpret_cast<Slot*>(body + paddingSize);
+    block->slotCount = (BlockSize_ - (sizeof(Block) + paddingSize)) / SlotSize_;
+    block->freeSlots = 0;
 
     // 超过该标记位置，则说明该内存块已无内存槽可用，需向系统申请新的内存块
     lastSlot_ = reinterpret_cast<Slot*>(reinterpret_cast<size_t>(newBlock) + BlockSize_ - SlotSize_ + 1);
@@ -96,95 +181,52 @@ size_t MemoryPool::padPointer(char* p, size_t align) {
     return (align - (result % align)) % align;
 }
 
-// 实现无锁入队操作
-bool MemoryPool::pushFreeList(Slot* slot) {
-    while(true) {
-        // 获取当前头节点
-        // load() 方法用于从一个原子变量读取当前值（线程安全的读取）。
-        // 只保证安全读，但暂不要求内存同步其他数据状态。
-        // 因为后续真正关键的同步是在CAS中。
-        // oldHead
-        //   |
-        //   v
-        // freeList_ -> SlotA -> SlotB -> nullptr
-        Slot* oldHead = freeList_.load(std::memory_order_relaxed);
-
-        // 将新节点的 next 指向当前头节点
-        // 相当于 slot->next = oldHead; // 普通链表
-        // slot -> oldHead -> SlotA -> SlotB -> nullptr
-        slot->next.store(oldHead, std::memory_order_relaxed);
-
-        // 尝试将新节点设置为头节点
-        // 比较当前链表头（freeList_）是否等于之前读到的oldHead
-        // std::memory_order_release表示若CAS成功，之前的所有操作（尤其是slot->next.store）对其他线程变为可见（内存同步完成）。
-        // 相当于发布一个“同步成功”的信号。
-        // memory_order_relaxed（失败情况）：
-        // 若失败，暂不要求严格的内存同步，因为失败后立即重试。
-        if(freeList_.compare_exchange_weak(oldHead, slot, std::memory_order_release, std::memory_order_relaxed)) {
-            return true;
-        }
-        // 失败：说明另一个线程可能已经修改了 freeList_
-        // CAS 失败则重试
+void HashBucket::initMemoryPool() {
+    for(int i = 0; i < MEMORY_POOL_NUM; ++i) {
+        getMemoryPool(i).init((i + 1) * SLOT_BASE_SIZE);
     }
 }
 
-// 实现无锁出队操作
-Slot* MemoryPool::popFreeList() {
-    while(true) {
-        // 生产者线程用release发布数据；
-        // 消费者线程用acquire获取最新发布的数据。
-
-        // 用memory_order_acquire确保了线程间正确的数据同步
-        Slot* oldHead = freeList_.load(std::memory_order_acquire);
-        if(oldHead == nullptr) {
-            // 队列为空
-            return nullptr;
-        }
-
-        // 在访问 newHead 之前再次验证 oldHead 的有效性
-        Slot* newHead = nullptr;
-        try {
-            newHead = oldHead->next.load(std::memory_order_relaxed);
-        } catch(...) {
-            // 如果返回失败，则continue重新尝试申请内存
-            continue;
-        }
+size_t HashBucket::shrink() {
+    size_t released = 0;
+    for(int i = 0; i < MEMORY_POOL_NUM; ++i) {
+        released += getMemoryPool(i).shrink();
+    }
+    return released;
+}
 
-        // 尝试更新头结点
-        // std::memory_order_acquire：
-        // 确保当前线程在执行此操作之后的所有读取操作不会被重排到此操作之前。这是为了确保你读取到的原子变量的值是正确且同步的。
-
-        // std::memory_order_release：
-        // 确保当前线程在执行此操作之前的所有写入操作不会被重排到此操作之后。这用于确保你对某个共享资源的修改对于其他线程是可见的。
-
-        // std::memory_order_relaxed：
-        // 不保证任何同步，指令可以自由重排，仅保证原子操作的顺序。
-        // 原子性地尝试将 freeList_ 从 oldHead 更新为 newHead
-        // bool compare_exchange_weak(T& expected, T desired, 
-        //                    memory_order success_order,
-        //                    memory_order failure_order);
-        // 比较原子变量当前值与expected是否相等：
-        // 如果相等：
-        // 原子地将当前值修改为desired（期望值）。
-        // 返回true表示CAS成功。
-        // success_order	CAS成功时的内存顺序	memory_order_acquire
-        // failure_order	CAS失败时的内存顺序	memory_order_relaxed
-        // std::memory_order_acquire：表示如果CAS操作成功，那么所有随后的内存操作（如对freeList_的读取操作）不会被重排到CAS之前。确保你之后读取freeList_时是正确的。
-        // 这就意味着，在CAS操作成功之后，你能获取到newHead的值，并且它之前的所有操作（如读取freeList_的值）都不会被重排。
-        if(freeList_.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_relaxed)) {
-            return oldHead;
-        }
-        // 失败：说明另一个线程可能已经修改了 freeList_
-        // CAS 失败则重试
+size_t HashBucket::trim() {
+    size_t released = 0;
+    for(int i = 0; i < MEMORY_POOL_NUM; ++i) {
+        released += getMemoryPool(i).trim();
     }
+    return released;
 }
 
-void HashBucket::initMemoryPool() {
+void HashBucket::setIdleWatermark(size_t watermark) {
     for(int i = 0; i < MEMORY_POOL_NUM; ++i) {
-        getMemoryPool(i).init((i + 1) * SLOT_BASE_SIZE);
+        getMemoryPool(i).setIdleWatermark(watermark);
     }
 }
 
+void* HashBucket::allocateLarge(size_t size) {
+    if(size > SIZE_MAX - LARGE_HEADER_SIZE) {
+        throw std::bad_alloc();
+    }
+    void* base = nullptr;
+    if(posix_memalign(&base, BLOCK_SIZE, size + LARGE_HEADER_SIZE) != 0) {
+        throw std::bad_alloc();
+    }
+    Block* header = reinterpret_cast<Block*>(base);
+    header->owner = nullptr;
+    header->next = nullptr;
+    return reinterpret_cast<char*>(base) + LARGE_HEADER_SIZE;
+}
+
+void HashBucket::freeLarge(void* ptr) {
+    free(reinterpret_cast<char*>(ptr) - LARGE_HEADER_SIZE);
+}
+
 // 单例模式
 MemoryPool& HashBucket::getMemoryPool(int index) {
     // static 关键字确保该数组仅第一次调用时初始化一次，整个程序生命周期中只存在一份。
@@ -4,14 +4,19 @@
 #include <cassert>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <type_traits>
 
 namespace MemoryPoolv1 {
 
 #define MEMORY_POOL_NUM 64
 #define SLOT_BASE_SIZE 8
 #define MAX_SLOT_SIZE 512
+// HashBucket 中内存池的内存块大小，也是内存块的对齐大小
+#define BLOCK_SIZE 4096
 
 /* 具体内存池的槽大小没法确定，因为每个内存池的槽大小不同(8的倍数)
 所以这个槽结构体的sizeof 不是实际的槽大小 */
@@ -22,9 +27,35 @@ struct Slot {
     std::atomic<Slot*> next;
 };
 
+// 内存块头部，位于每个内存块的起始位置
+// 内存块按 BlockSize_ 对齐分配，因此任意槽地址向下对齐到 BlockSize_ 即可找到所属内存块
+class MemoryPool;
+
+struct Block {
+    // 所属内存池
+    MemoryPool*             owner;
+    // 指向下一个内存块
+    Block*                  next;
+    // 该内存块能切出的槽数量
+    size_t                  slotCount;
+    // 只在 shrink 统计空闲链表时使用：该内存块有多少个槽在空闲链表中，等于 slotCount 时整个内存块空闲
+    size_t                  freeSlots;
+};
+
 class MemoryPool {
 public:
-    MemoryPool(size_t BlockSize = 4096);
+    MemoryPool(size_t BlockSize = BLOCK_SIZE);
+    // BlockSize 必须为 2 的幂且不超过 INT_MAX（ObjectPool 中静态检查），SlotSize 必须为 sizeof(Slot) 的倍数
+    // BlockSize 必须为 2 的幂，SlotSize 必须为 sizeof(Slot) 的倍数
+    constexpr MemoryPool(size_t BlockSize, size_t SlotSize)
+        : BlockSize_(static_cast<int>(BlockSize))
+        , SlotSize_(static_cast<int>(SlotSize))
+        , firstBlock_(nullptr)
+        , curSlot_(nullptr)
+        , freeList_(nullptr)
+        , lastSlot_(nullptr)
+        , idleWatermark_(0)
+        {}
     ~MemoryPool();
 
     void init(size_t);
@@ -32,21 +63,48 @@ public:
     void* allocate();
     void deallocate(void*);
 
+    // 将完全空闲的内存块（当前正在切分的内存块除外）归还给系统，返回归还的内存块数量
+    // 调用期间不能有其他线程在该内存池上 allocate/deallocate：
+    // 无锁出队会读取链表头槽的 next，内存块被释放后这样的读取不再安全
+    size_t shrink();
+
+    // 按阈值归还：完全空闲的内存块超过 watermark 个时归还到只剩 watermark / 2 个，
+    // 避免周期性调用时空闲内存块数在阈值附近反复申请和归还；阈值为 0 时不归还，返回归还的内存块数量
+    // 与 shrink 一样只能在没有并发 allocate/deallocate 时调用（例如各阶段之间的同步点）
+    size_t trim();
+    void setIdleWatermark(size_t watermark);
+
 private:
     void allocateNewBlock();
+    Slot* allocateFromBlock();
     size_t padPointer(char* p, size_t align);
 
+    // 根据槽地址找到所属内存块
+    Block* blockOf(void* p) const {
+        return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(p) & ~static_cast<uintptr_t>(BlockSize_ - 1));
+    }
+
+    // 取下整个空闲链表，统计各内存块的空闲槽；完全空闲的内存块（当前正在切分的除外）超过 threshold 个时
+    // 从内存块链表中摘下，直到只剩 keep 个，其余槽放回空闲链表
+    // 摘下的内存块通过 next 串成链表返回，需持有 mutexForBlock_ 且没有并发的出队/入队
+    Block* detachIdleBlocks(size_t threshold, size_t keep);
+    static size_t freeBlocks(Block* block);
+
     // 使用CAS操作进行无锁入队和出队
     bool pushFreeList(Slot* slot);
     Slot* popFreeList();
 
+    // ObjectPool 直接使用空闲链表和切分，省去 allocate/deallocate 的空指针检查
+    template <typename T>
+    friend class ObjectPool;
+
 private:
     // 内存块大小
     int                     BlockSize_;
     // 槽大小
     int                     SlotSize_;
-    // 指向内存池管理的首个实际内存块
-    Slot*                   firstBlock_;
+    // 指向内存池管理的首个实际内存块（即当前正在切分的内存块）
+    Block*                  firstBlock_;
     // 指向当前未被使用过的槽
     Slot*                   curSlot_;
     // 指向空闲的槽(被使用过后又被释放的槽)
@@ -56,20 +114,128 @@ private:
     //std::mutex          mutexForFreeList_; // 保证freeList_在多线程中操作的原子性
     // 保证多线程情况下避免不必要的重复开辟内存导致的浪费行为
     std::mutex              mutexForBlock_;
+    // trim 的空闲内存块阈值
+    size_t                  idleWatermark_;
 };
 
+inline void* MemoryPool::allocate() {
+    // 优先使用空闲链表中的内存槽
+    Slot* slot = popFreeList();
+    if(slot == nullptr) {
+        slot = allocateFromBlock();
+    }
+    return slot;
+}
+
+inline void MemoryPool::deallocate(void* ptr) {
+    if(!ptr) {
+        return;
+    }
+    pushFreeList(reinterpret_cast<Slot*>(ptr));
+}
+
+// 实现无锁入队操作
+inline bool MemoryPool::pushFreeList(Slot* slot) {
+    while(true) {
+        // 获取当前头节点
+        // load() 方法用于从一个原子变量读取当前值（线程安全的读取）。
+        // 只保证安全读，但暂不要求内存同步其他数据状态。
+        // 因为后续真正关键的同步是在CAS中。
+        // oldHead
+        //   |
+        //   v
+        // freeList_ -> SlotA -> SlotB -> nullptr
+        Slot* oldHead = freeList_.load(std::memory_order_relaxed);
+
+        // 将新节点的 next 指向当前头节点
+        // 相当于 slot->next = oldHead; // 普通链表
+        // slot -> oldHead -> SlotA -> SlotB -> nullptr
+        slot->next.store(oldHead, std::memory_order_relaxed);
+
+        // 尝试将新节点设置为头节点
+        // 比较当前链表头（freeList_）是否等于之前读到的oldHead
+        // std::memory_order_release表示若CAS成功，之前的所有操作（尤其是slot->next.store）对其他线程变为可见（内存同步完成）。
+        // 相当于发布一个“同步成功”的信号。
+        // memory_order_relaxed（失败情况）：
+        // 若失败，暂不要求严格的内存同步，因为失败后立即重试。
+        if(freeList_.compare_exchange_weak(oldHead, slot, std::memory_order_release, std::memory_order_relaxed)) {
+            return true;
+        }
+        // 失败：说明另一个线程可能已经修改了 freeList_
+        // CAS 失败则重试
+    }
+}
+
+// 实现无锁出队操作
+inline Slot* MemoryPool::popFreeList() {
+    while(true) {
+        // 生产者线程用release发布数据；
+        // 消费者线程用acquire获取最新发布的数据。
+
+        // 用memory_order_acquire确保了线程间正确的数据同步
+        Slot* oldHead = freeList_.load(std::memory_order_acquire);
+        if(oldHead == nullptr) {
+            // 队列为空
+            return nullptr;
+        }
+
+        // 在访问 newHead 之前再次验证 oldHead 的有效性
+        Slot* newHead = nullptr;
+        try {
+            newHead = oldHead->next.load(std::memory_order_relaxed);
+        } catch(...) {
+            // 如果返回失败，则continue重新尝试申请内存
+            continue;
+        }
+
+        // 尝试更新头结点
+        // std::memory_order_acquire：
+        // 确保当前线程在执行此操作之后的所有读取操作不会被重排到此操作之前。这是为了确保你读取到的原子变量的值是正确且同步的。
+
+        // std::memory_order_release：
+        // 确保当前线程在执行此操作之前的所有写入操作不会被重排到此操作之后。这用于确保你对某个共享资源的修改对于其他线程是可见的。
+
+        // std::memory_order_relaxed：
+        // 不保证任何同步，指令可以自由重排，仅保证原子操作的顺序。
+        // 原子性地尝试将 freeList_ 从 oldHead 更新为 newHead
+        // bool compare_exchange_weak(T& expected, T desired, 
+        //                    memory_order success_order,
+        //                    memory_order failure_order);
+        // 比较原子变量当前值与expected是否相等：
+        // 如果相等：
+        // 原子地将当前值修改为desired（期望值）。
+        // 返回true表示CAS成功。
+        // success_order	CAS成功时的内存顺序	memory_order_acquire
+        // failure_order	CAS失败时的内存顺序	memory_order_relaxed
+        // std::memory_order_acquire：表示如果CAS操作成功，那么所有随后的内存操作（如对freeList_的读取操作）不会被重排到CAS之前。确保你之后读取freeList_时是正确的。
+        // 这就意味着，在CAS操作成功之后，你能获取到newHead的值，并且它之前的所有操作（如读取freeList_的值）都不会被重排。
+        if(freeList_.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return oldHead;
+        }
+        // 失败：说明另一个线程可能已经修改了 freeList_
+        // CAS 失败则重试
+    }
+}
+
 class HashBucket {
 public:
     static void initMemoryPool();
     static MemoryPool& getMemoryPool(int index);
 
+    // 归还所有内存池中完全空闲的内存块，返回归还的内存块总数
+    static size_t shrink();
+    // 按阈值归还所有内存池中多余的空闲内存块，返回归还的内存块总数
+    static size_t trim();
+    // 为所有内存池设置 trim 的空闲内存块阈值
+    static void setIdleWatermark(size_t watermark);
+
     static void* useMemory(size_t size) {
         if(size <= 0) {
             return nullptr;
         } 
-        // 大于512字节的内存，则使用new
+        // 大于512字节的内存，直接向系统申请（带头部，便于 freeMemory(void*) 识别）
         if(size > MAX_SLOT_SIZE) {
-            return operator new(size);
+            return allocateLarge(size);
         }
 
         // 相当于size / 8 向上取整（因为分配内存只能大不能小
@@ -81,18 +247,48 @@ public:
             return;
         }
         if(size > MAX_SLOT_SIZE) {
-            operator delete(ptr);
+            freeLarge(ptr);
             return;
         }
 
         getMemoryPool(((size + 7) / SLOT_BASE_SIZE) - 1).deallocate(ptr);
     }
 
+    // 不需要大小的释放：将地址向下对齐到 BLOCK_SIZE 得到内存块头部，
+    // 头部记录了所属内存池则由其回收，否则是 allocateLarge 分配的大对象
+    // 只适用于 useMemory/newElement 分配的内存（ObjectPool 的内存块大小可能不同）
+    static void freeMemory(void* ptr) {
+        if(!ptr) {
+            return;
+        }
+        Block* block = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(BLOCK_SIZE - 1));
+        if(block->owner) {
+            block->owner->deallocate(ptr);
+        } else {
+            freeLarge(ptr);
+        }
+    }
+
+private:
+    // 大对象同样按 BLOCK_SIZE 对齐申请，起始处放一个 owner 为空的内存块头部，
+    // 返回地址紧跟在头部之后（保持 16 字节对齐），向下对齐即可得到头部
+    static const size_t LARGE_HEADER_SIZE = (sizeof(Block) + 15) & ~static_cast<size_t>(15);
+
+    static void* allocateLarge(size_t size);
+    static void freeLarge(void* ptr);
+
+public:
     template <typename T, typename... Args>
     friend T* newElement(Args&&... args);
 
     template <typename T>
     friend void deleteElement(T* p);
+
+    template <typename T>
+    friend T* newArray(size_t n);
+
+    template <typename T>
+    friend void deleteArray(T* p);
 };
 
 template <typename T, typename... Args>
@@ -106,13 +302,151 @@ T* newElement(Args&&... args) {
     return p;
 }
 
+namespace detail {
+// 多态类型可能通过基类指针释放，需要取得最派生对象的起始地址
+template <typename T>
+void* objectStart(T* p, std::true_type) {
+    return dynamic_cast<void*>(p);
+}
+
+template <typename T>
+void* objectStart(T* p, std::false_type) {
+    return reinterpret_cast<void*>(p);
+}
+} // namespace detail
+
 template <typename T>
 void deleteElement(T* p) {
     // 对象析构
     if(p) {
+        void* start = detail::objectStart(p, std::is_polymorphic<T>());
         p->~T();
         // 内存回收
-        HashBucket::freeMemory(reinterpret_cast<void*>(p), sizeof(T));
+        // 多态类型的 sizeof(T) 不一定是实际对象大小，按地址查找所属内存池
+        if(std::is_polymorphic<T>::value) {
+            HashBucket::freeMemory(start);
+        } else {
+            HashBucket::freeMemory(start, sizeof(T));
+        }
+    }
+}
+
+// 数组分配：总大小不超过 MAX_SLOT_SIZE 的数组放在对应大小的内存池中，更大的数组走大对象路径
+// 元素可平凡析构时不需要记录元素个数（释放时按地址找回所属内存池），
+// 否则在数组前用一个 size_t 记录元素个数，供 deleteArray 逐个析构
+template <typename T>
+T* newArray(size_t n) {
+    static_assert(alignof(T) <= SLOT_BASE_SIZE, "newArray only supports alignof(T) <= 8");
+    if(n == 0) {
+        return nullptr;
+    }
+
+    const size_t header = std::is_trivially_destructible<T>::value ? 0 : sizeof(size_t);
+    if(n > (SIZE_MAX - header) / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+
+    void* mem = HashBucket::useMemory(header + n * sizeof(T));
+    if(header) {
+        *reinterpret_cast<size_t*>(mem) = n;
     }
+    T* p = reinterpret_cast<T*>(reinterpret_cast<char*>(mem) + header);
+
+    // 逐个构造元素，构造失败时析构已构造的元素并归还内存
+    size_t i = 0;
+    try {
+        for(; i < n; ++i) {
+            new (p + i) T();
+        }
+    } catch(...) {
+        while(i > 0) {
+            p[--i].~T();
+        }
+        HashBucket::freeMemory(mem);
+        throw;
+    }
+    return p;
 }
-} // namespace MemoryPoolv1
\ No newline at end of file
+
+template <typename T>
+void deleteArray(T* p) {
+    if(!p) {
+        return;
+    }
+    if(std::is_trivially_destructible<T>::value) {
+        HashBucket::freeMemory(reinterpret_cast<void*>(p));
+        return;
+    }
+
+    // 按构造的逆序析构
+    void* mem = reinterpret_cast<char*>(p) - sizeof(size_t);
+    size_t n = *reinterpret_cast<size_t*>(mem);
+    while(n > 0) {
+        p[--n].~T();
+    }
+    HashBucket::freeMemory(mem);
+}
+
+// 计算对象池的内存块大小：至少 4096 字节，且至少能容纳 16 个槽
+constexpr size_t objectPoolBlockSize(size_t slotSize, size_t blockSize = 4096) {
+    return blockSize >= slotSize * 16 ? blockSize : objectPoolBlockSize(slotSize, blockSize * 2);
+}
+
+// 类型化的对象池：槽大小、对齐和内存池实例都在编译期确定
+// 与 newElement/deleteElement 相比，不需要在运行时计算内存池索引，
+// 也不经过 HashBucket::getMemoryPool 中函数内静态变量的初始化检查
+// 每个类型 T 拥有独立的内存池，支持 alignof(T) > 8 的类型
+template <typename T>
+class ObjectPool {
+public:
+    // 槽对齐：至少为 SLOT_BASE_SIZE（能存放 Slot 的 next 指针）
+    static constexpr size_t SlotAlign = alignof(T) > SLOT_BASE_SIZE ? alignof(T) : SLOT_BASE_SIZE;
+    // 槽大小：sizeof(T) 向上取整到 SlotAlign 的倍数
+    // 内存池让槽地址对齐到槽大小的倍数，因此槽大小为 SlotAlign 的倍数即可保证对齐
+    static constexpr size_t SlotSize = (sizeof(T) + SlotAlign - 1) / SlotAlign * SlotAlign;
+    static constexpr size_t BlockSize = objectPoolBlockSize(SlotSize);
+
+    static_assert((SlotAlign & (SlotAlign - 1)) == 0, "alignment must be a power of two");
+    // MemoryPool 以 int 保存内存块大小和槽大小
+    static_assert(BlockSize <= static_cast<size_t>(std::numeric_limits<int>::max()), "object too large for ObjectPool");
+
+    // 只做出队/切分和入队：需要归还内存时显式调用 pool().shrink()
+    template <typename... Args>
+    static T* newElement(Args&&... args) {
+        Slot* slot = pool_.popFreeList();
+        if(slot == nullptr) {
+            slot = pool_.allocateFromBlock();
+        }
+        T* p = reinterpret_cast<T*>(slot);
+        new (p) T(std::forward<Args>(args)...);
+        return p;
+    }
+
+    static void deleteElement(T* p) {
+        if(p) {
+            p->~T();
+            pool_.pushFreeList(reinterpret_cast<Slot*>(p));
+        }
+    }
+
+    static MemoryPool& pool() {
+        return pool_;
+    }
+
+private:
+    // 常量初始化的静态成员，访问时不需要初始化检查
+    static MemoryPool pool_;
+};
+
+template <typename T>
+constexpr size_t ObjectPool<T>::SlotAlign;
+
+template <typename T>
+constexpr size_t ObjectPool<T>::SlotSize;
+
+template <typename T>
+constexpr size_t ObjectPool<T>::BlockSize;
+
+template <typename T>
+MemoryPool ObjectPool<T>::pool_(ObjectPool<T>::BlockSize, ObjectPool<T>::SlotSize);
+} // namespace MemoryPoolv1
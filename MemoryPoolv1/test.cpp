@@ -25,6 +25,37 @@ class P4
     int id_[20];
 };
 
+// 对齐要求大于8字节的类型
+struct alignas(64) P5
+{
+    int id_[4];
+};
+
+// 多态类型，通过基类指针释放
+class Node {
+public:
+    virtual ~Node() {}
+};
+
+class SmallNode : public Node {
+    int id_[3];
+};
+
+class LargeNode : public Node {
+    int id_[200];
+};
+
+// 带析构函数的类型，用于检查数组元素是否全部析构
+static int g_liveCounted = 0;
+
+class Counted {
+public:
+    Counted() { ++g_liveCounted; }
+    ~Counted() { --g_liveCounted; }
+private:
+    int id_;
+};
+
 // 单轮次申请释放次数 线程数 轮次
 void BenchmarkMemoryPool(size_t ntimes, size_t nworks, size_t rounds) {
     // 线程池
@@ -61,6 +92,48 @@ void BenchmarkMemoryPool(size_t ntimes, size_t nworks, size_t rounds) {
     printf("%lu个线程并发执行%lu轮次，每轮次newElement&deleteElement %lu次，总计花费：%lu ms\n", nworks, rounds, ntimes, total_costtime);
 }
 
+// 使用编译期确定内存池的 ObjectPool<T>
+void BenchmarkObjectPool(size_t ntimes, size_t nworks, size_t rounds) {
+    std::vector<std::thread> vthread(nworks);
+    size_t total_costtime = 0;
+    for(size_t k = 0; k < nworks; ++k) {
+        vthread[k] = std::thread([&]() {
+            for(size_t j = 0; j < rounds; ++j) {
+                size_t begin1 = clock();
+                for(size_t i = 0; i < ntimes; ++i) {
+                    P1* p1 = ObjectPool<P1>::newElement();
+                    ObjectPool<P1>::deleteElement(p1);
+                    P2* p2 = ObjectPool<P2>::newElement();
+                    ObjectPool<P2>::deleteElement(p2);
+                    P3* p3 = ObjectPool<P3>::newElement();
+                    ObjectPool<P3>::deleteElement(p3);
+                    P4* p4 = ObjectPool<P4>::newElement();
+                    ObjectPool<P4>::deleteElement(p4);
+                }
+                size_t end1 = clock();
+                total_costtime += end1 - begin1;
+            }
+        });
+    }
+    for(auto &t: vthread) {
+        t.join();
+    }
+    printf("%lu个线程并发执行%lu轮次，每轮次ObjectPool newElement&deleteElement %lu次，总计花费：%lu ms\n", nworks, rounds, ntimes, total_costtime);
+}
+
+// 对齐要求大于 8 的类型，ObjectPool 按 alignof(T) 对齐槽
+void TestObjectPoolAlign(size_t n) {
+    std::vector<P5*> ptrs(n);
+    for(size_t i = 0; i < n; ++i) {
+        ptrs[i] = ObjectPool<P5>::newElement();
+        assert(reinterpret_cast<uintptr_t>(ptrs[i]) % alignof(P5) == 0);
+    }
+    for(size_t i = 0; i < n; ++i) {
+        ObjectPool<P5>::deleteElement(ptrs[i]);
+    }
+    printf("ObjectPool对齐测试完成\n");
+}
+
 void BenchmarkNew(size_t ntimes, size_t nworks, size_t rounds) {
     std::vector<std::thread> vthread(nworks);
     size_t total_costtime = 0;
@@ -90,6 +163,75 @@ void BenchmarkNew(size_t ntimes, size_t nworks, size_t rounds) {
     printf("%lu个线程并发执行%lu轮次，每轮次new&delete %lu次，总计花费：%lu ms\n", nworks, rounds, ntimes, total_costtime);
 }
 
+// 一次性申请大量对象后全部释放，检查空闲内存块能否归还
+void TestShrink(size_t n) {
+    std::vector<P4*> ptrs(n);
+    for(size_t i = 0; i < n; ++i) {
+        ptrs[i] = newElement<P4>();
+    }
+    for(size_t i = 0; i < n; ++i) {
+        deleteElement<P4>(ptrs[i]);
+    }
+    size_t released = HashBucket::shrink();
+    printf("申请并释放%lu个对象后，shrink归还内存块：%lu 个\n", n, released);
+}
+
+// 设置阈值后 trim 只归还多余的空闲内存块，保留 watermark / 2 个
+void TestIdleWatermark(size_t n) {
+    const size_t watermark = 8;
+    HashBucket::setIdleWatermark(watermark);
+    std::vector<P4*> ptrs(n);
+    for(size_t i = 0; i < n; ++i) {
+        ptrs[i] = newElement<P4>();
+    }
+    for(size_t i = 0; i < n; ++i) {
+        deleteElement<P4>(ptrs[i]);
+    }
+    size_t released = HashBucket::trim();
+    HashBucket::setIdleWatermark(0);
+    size_t remaining = HashBucket::shrink();
+    assert(remaining == watermark / 2);
+    printf("阈值为%lu时申请并释放%lu个对象，trim归还内存块：%lu 个，剩余空闲内存块：%lu 个\n", watermark, n, released, remaining);
+}
+
+// 通过基类指针释放派生类对象，内存按地址找回所属内存池
+void TestPolymorphicDelete(size_t n) {
+    std::vector<Node*> nodes;
+    for(size_t i = 0; i < n; ++i) {
+        if(i % 2) {
+            nodes.push_back(newElement<SmallNode>());
+        } else {
+            nodes.push_back(newElement<LargeNode>());
+        }
+    }
+    for(Node* node: nodes) {
+        deleteElement<Node>(node);
+    }
+    // 释放后再次申请应复用原来的槽
+    SmallNode* reused = newElement<SmallNode>();
+    deleteElement<Node>(reused);
+    printf("通过基类指针释放%lu个派生类对象完成\n", n);
+}
+
+// 小数组放在对应大小的内存池中，大数组走大对象路径
+void TestArray() {
+    // 可平凡析构的类型，不记录元素个数
+    P1* small = newArray<P1>(16);
+    P1* large = newArray<P1>(1000);
+    deleteArray(small);
+    deleteArray(large);
+
+    // 需要析构的类型，释放时逐个析构
+    Counted* counted = newArray<Counted>(16);
+    assert(g_liveCounted == 16);
+    deleteArray(counted);
+    counted = newArray<Counted>(1000);
+    assert(g_liveCounted == 1000);
+    deleteArray(counted);
+    assert(g_liveCounted == 0);
+    printf("newArray&deleteArray测试完成\n");
+}
+
 int main() {
     // 使用内存池接口前一定要先调用该函数
     // static MemoryPool MemoryPool[MEMORY_POOL_NUM];
@@ -106,7 +248,27 @@ int main() {
     std::cout << "===========================================================================" << std::endl;
 	std::cout << "===========================================================================" << std::endl;
     
+    // 测试 ObjectPool
+    BenchmarkObjectPool(100, 1, 10);
+    std::cout << "===========================================================================" << std::endl;
+
     // 测试 new delete
     BenchmarkNew(100, 1, 10);
+    std::cout << "===========================================================================" << std::endl;
+
+    // 测试 ObjectPool 对齐
+    TestObjectPoolAlign(1000);
+
+    // 测试数组分配
+    TestArray();
+
+    // 测试通过基类指针释放
+    TestPolymorphicDelete(1000);
+
+    // 测试空闲内存块归还
+    TestShrink(10000);
+
+    // 测试按阈值归还空闲内存块
+    TestIdleWatermark(100000);
     return 0;
 }
\ No newline at end of file
@@ -1,4 +1,12 @@
 #include "MemoryPool.h"
+#include "PoolAllocator.h"
+#include "PmrResource.h"
+#include "PoolBuffer.h"
+#include "Arena.h"
+#include "Heap.h"
+#include "PageCache.h"
+#include "PageMap.h"
+#include "Numa.h"
 #include <iostream>
 #include <vector>
 #include <chrono>
@@ -6,6 +14,20 @@
 #include <iomanip>
 #include <thread>
 #include <array>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
 
 using namespace MemoryPoolv2;
 using namespace std::chrono;
@@ -26,6 +48,48 @@ public:
     }
 };
 
+// dTLB 读未命中计数器，只统计当前线程的用户态；perf_event_open 不可用时 valid() 为 false
+class DtlbMissCounter {
+private:
+    int fd;
+public:
+    DtlbMissCounter() {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~DtlbMissCounter() {
+        if(fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool valid() const { return fd >= 0; }
+
+    void start() {
+        if(fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    uint64_t stop() {
+        uint64_t count = 0;
+        if(fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+        return count;
+    }
+};
+
 // 性能测试类
 class PerformanceTest {
 private:
@@ -426,6 +490,885 @@ public:
                       << t.elapsed() << " ms" << std::endl;
     }
     }
+
+    // 5. 标准库容器测试：PoolAllocator 与 std::allocator 对比
+    static void testStlContainers() {
+        constexpr size_t NUM_ELEMENTS = 100000;
+
+        std::cout << "\nTesting STL containers (" << NUM_ELEMENTS
+                  << " elements each):" << std::endl;
+
+        printContainerResult("std::map", benchMap<PoolAllocator>(NUM_ELEMENTS),
+                             benchMap<std::allocator>(NUM_ELEMENTS));
+        printContainerResult("std::list", benchList<PoolAllocator>(NUM_ELEMENTS),
+                             benchList<std::allocator>(NUM_ELEMENTS));
+        printContainerResult("std::unordered_map", benchUnorderedMap<PoolAllocator>(NUM_ELEMENTS),
+                             benchUnorderedMap<std::allocator>(NUM_ELEMENTS));
+        printContainerResult("std::deque", benchDeque<PoolAllocator>(NUM_ELEMENTS),
+                             benchDeque<std::allocator>(NUM_ELEMENTS));
+    }
+
+    // 6. std::pmr 容器测试：poolResource / MonotonicPoolResource 与 new_delete_resource 对比
+    static void testPmrContainers() {
+        constexpr size_t NUM_ELEMENTS = 100000;
+
+        std::cout << "\nTesting std::pmr containers (" << NUM_ELEMENTS
+                  << " elements each):" << std::endl;
+
+        double poolTime = benchPmr(poolResource(), NUM_ELEMENTS);
+        double newDeleteTime = benchPmr(std::pmr::new_delete_resource(), NUM_ELEMENTS);
+        double monotonicTime;
+        {
+            Timer t;
+            MonotonicPoolResource monotonic;
+            runPmrWorkload(&monotonic, NUM_ELEMENTS);
+            monotonic.release();
+            monotonicTime = t.elapsed();
+        }
+
+        std::cout << "poolResource: " << std::fixed << std::setprecision(3) << poolTime << " ms" << std::endl;
+        std::cout << "MonotonicPoolResource: " << std::fixed << std::setprecision(3) << monotonicTime << " ms" << std::endl;
+        std::cout << "new_delete_resource: " << std::fixed << std::setprecision(3) << newDeleteTime << " ms" << std::endl;
+    }
+
+    // 7. 清零分配测试：allocateZeroed 与 allocate + memset、calloc 对比
+    static void testZeroedAllocation() {
+        constexpr size_t NUM_ALLOCS = 500;
+
+        std::cout << "\nTesting zeroed allocations (" << NUM_ALLOCS
+                  << " allocations per size, half of them freed and reallocated):" << std::endl;
+
+        for(size_t size : {size_t(64), size_t(4096), size_t(64 * 1024), size_t(1024 * 1024)}) {
+            double zeroedTime = benchZeroed(size, NUM_ALLOCS, [](size_t n) {
+                return MemoryPool::allocateZeroed(n);
+            }, [](void* p, size_t n) { MemoryPool::deallocate(p, n); });
+            double memsetTime = benchZeroed(size, NUM_ALLOCS, [](size_t n) {
+                void* p = MemoryPool::allocate(n);
+                memset(p, 0, n);
+                return p;
+            }, [](void* p, size_t n) { MemoryPool::deallocate(p, n); });
+            double callocTime = benchZeroed(size, NUM_ALLOCS, [](size_t n) {
+                return calloc(1, n);
+            }, [](void* p, size_t) { free(p); });
+
+            std::cout << size << " bytes: allocateZeroed " << std::fixed << std::setprecision(3)
+                      << zeroedTime << " ms, allocate+memset " << memsetTime
+                      << " ms, calloc " << callocTime << " ms" << std::endl;
+        }
+    }
+
+    // 8. 可增长缓冲区测试：PoolBuffer 用满大小类余量后才扩容，与 std::string 对比扩容次数和耗时
+    static void testGrowableBuffer() {
+        constexpr size_t NUM_BUFFERS = 2000;
+        constexpr size_t NUM_APPENDS = 500;
+        const char piece[] = "0123456789abcdefghijk";  // 21 字节，不是 2 的幂
+
+        std::cout << "\nTesting growable buffers (" << NUM_BUFFERS << " buffers, "
+                  << NUM_APPENDS << " appends each):" << std::endl;
+
+        size_t poolGrowths = 0;
+        Timer t1;
+        for(size_t i = 0; i < NUM_BUFFERS; ++i) {
+            PoolBuffer buffer;
+            size_t capacity = buffer.capacity();
+            for(size_t j = 0; j < NUM_APPENDS; ++j) {
+                buffer.append(piece, sizeof(piece) - 1);
+                if(buffer.capacity() != capacity) {
+                    capacity = buffer.capacity();
+                    ++poolGrowths;
+                }
+            }
+        }
+        double poolTime = t1.elapsed();
+
+        size_t stdGrowths = 0;
+        Timer t2;
+        for(size_t i = 0; i < NUM_BUFFERS; ++i) {
+            std::string buffer;
+            size_t capacity = buffer.capacity();
+            for(size_t j = 0; j < NUM_APPENDS; ++j) {
+                buffer.append(piece, sizeof(piece) - 1);
+                if(buffer.capacity() != capacity) {
+                    capacity = buffer.capacity();
+                    ++stdGrowths;
+                }
+            }
+        }
+        double stdTime = t2.elapsed();
+
+        std::cout << "PoolBuffer: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, " << poolGrowths << " growths" << std::endl;
+        std::cout << "std::string: " << std::fixed << std::setprecision(3) << stdTime
+                  << " ms, " << stdGrowths << " growths" << std::endl;
+    }
+
+    // 9. 批量分配测试：allocateBatch/deallocateBatch 与逐个 allocate/deallocate 对比
+    static void testBatchAllocation() {
+        constexpr size_t NUM_NODES = 10000;
+        constexpr size_t NUM_ROUNDS = 100;
+        constexpr size_t NODE_SIZE = 48;
+
+        std::cout << "\nTesting batch allocation (" << NUM_ROUNDS << " rounds of "
+                  << NUM_NODES << " nodes):" << std::endl;
+
+        std::vector<void*> ptrs(NUM_NODES);
+        Timer t1;
+        for(size_t round = 0; round < NUM_ROUNDS; ++round) {
+            MemoryPool::allocateBatch(NODE_SIZE, NUM_NODES, ptrs.data());
+            MemoryPool::deallocateBatch(ptrs.data(), NUM_NODES, NODE_SIZE);
+        }
+        double batchTime = t1.elapsed();
+
+        Timer t2;
+        for(size_t round = 0; round < NUM_ROUNDS; ++round) {
+            for(size_t i = 0; i < NUM_NODES; ++i) {
+                ptrs[i] = MemoryPool::allocate(NODE_SIZE);
+            }
+            for(size_t i = 0; i < NUM_NODES; ++i) {
+                MemoryPool::deallocate(ptrs[i], NODE_SIZE);
+            }
+        }
+        double singleTime = t2.elapsed();
+
+        std::cout << "Batch: " << std::fixed << std::setprecision(3) << batchTime
+                  << " ms, one by one: " << singleTime << " ms" << std::endl;
+    }
+
+    // 10. 预留测试：首次分配某个大小类时的冷启动开销，与提前 reserve 后对比
+    // 两个大小类此前都没有使用过
+    static void testReserve() {
+        constexpr size_t NUM_ALLOCS = 2000;
+        constexpr size_t COLD_SIZE = 6008;
+        constexpr size_t WARM_SIZE = 6016;
+
+        std::cout << "\nTesting cold start (" << NUM_ALLOCS << " first allocations of a size class):" << std::endl;
+
+        std::vector<void*> ptrs(NUM_ALLOCS);
+        Timer t1;
+        for(size_t i = 0; i < NUM_ALLOCS; ++i) {
+            ptrs[i] = MemoryPool::allocate(COLD_SIZE);
+            memset(ptrs[i], 1, COLD_SIZE);
+        }
+        double coldTime = t1.elapsed();
+        for(void* p : ptrs) {
+            MemoryPool::deallocate(p, COLD_SIZE);
+        }
+
+        MemoryPool::reserve({{WARM_SIZE, NUM_ALLOCS}});
+        Timer t2;
+        for(size_t i = 0; i < NUM_ALLOCS; ++i) {
+            ptrs[i] = MemoryPool::allocate(WARM_SIZE);
+            memset(ptrs[i], 1, WARM_SIZE);
+        }
+        double warmTime = t2.elapsed();
+        for(void* p : ptrs) {
+            MemoryPool::deallocate(p, WARM_SIZE);
+        }
+
+        std::cout << "Cold: " << std::fixed << std::setprecision(3) << coldTime
+                  << " ms, after reserve: " << warmTime << " ms" << std::endl;
+    }
+
+    // 11. Arena 测试：模拟每个请求分配大量短生命周期对象后一起释放
+    static void testArena() {
+        constexpr size_t NUM_REQUESTS = 1000;
+        constexpr size_t OBJECTS_PER_REQUEST = 1000;
+        const size_t sizes[] = {16, 32, 48, 64, 96, 128};
+
+        std::cout << "\nTesting per-request arena (" << NUM_REQUESTS << " requests, "
+                  << OBJECTS_PER_REQUEST << " objects each):" << std::endl;
+
+        std::vector<std::pair<void*, size_t>> ptrs;
+        ptrs.reserve(OBJECTS_PER_REQUEST);
+        Timer t1;
+        for(size_t r = 0; r < NUM_REQUESTS; ++r) {
+            for(size_t i = 0; i < OBJECTS_PER_REQUEST; ++i) {
+                size_t size = sizes[i % 6];
+                ptrs.emplace_back(MemoryPool::allocate(size), size);
+            }
+            for(const auto& [p, size] : ptrs) {
+                MemoryPool::deallocate(p, size);
+            }
+            ptrs.clear();
+        }
+        double poolTime = t1.elapsed();
+
+        Arena arena;
+        Timer t2;
+        for(size_t r = 0; r < NUM_REQUESTS; ++r) {
+            for(size_t i = 0; i < OBJECTS_PER_REQUEST; ++i) {
+                arena.allocate(sizes[i % 6]);
+            }
+            arena.reset();
+        }
+        double arenaTime = t2.elapsed();
+
+        std::cout << "MemoryPool: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, Arena: " << arenaTime << " ms" << std::endl;
+    }
+
+    // 12. 独立堆测试：租户下线时逐个释放对象与 Heap::destroy 对比
+    static void testHeapDestroy() {
+        constexpr size_t NUM_OBJECTS = 200000;
+
+        std::cout << "\nTesting tenant teardown (" << NUM_OBJECTS << " objects):" << std::endl;
+
+        std::vector<std::pair<void*, size_t>> ptrs;
+        ptrs.reserve(NUM_OBJECTS);
+        for(size_t i = 0; i < NUM_OBJECTS; ++i) {
+            size_t size = 16 + (i % 32) * 8;
+            ptrs.emplace_back(MemoryPool::allocate(size), size);
+        }
+        Timer t1;
+        for(const auto& [p, size] : ptrs) {
+            MemoryPool::deallocate(p, size);
+        }
+        double freeTime = t1.elapsed();
+
+        Heap heap;
+        for(size_t i = 0; i < NUM_OBJECTS; ++i) {
+            heap.allocate(16 + (i % 32) * 8);
+        }
+        Timer t2;
+        heap.destroy();
+        double destroyTime = t2.elapsed();
+
+        std::cout << "Per-object free: " << std::fixed << std::setprecision(3) << freeTime
+                  << " ms, Heap::destroy: " << destroyTime << " ms" << std::endl;
+    }
+
+    // 13. 生产者/消费者测试：一个线程分配，另一个线程释放
+    static void testProducerConsumer() {
+        constexpr size_t NUM_BATCHES = 2000;
+        constexpr size_t BATCH_SIZE = 256;
+        constexpr size_t SIZE = 128;
+
+        std::cout << "\nTesting producer/consumer (" << NUM_BATCHES * BATCH_SIZE
+                  << " objects of " << SIZE << " bytes):" << std::endl;
+
+        double poolTime = benchPipeline(NUM_BATCHES, BATCH_SIZE, SIZE,
+            [](size_t size) { return MemoryPool::allocate(size); },
+            [](void* p, size_t size) { MemoryPool::deallocate(p, size); });
+        double newTime = benchPipeline(NUM_BATCHES, BATCH_SIZE, SIZE,
+            [](size_t size) { return ::operator new(size); },
+            [](void* p, size_t) { ::operator delete(p); });
+
+        std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, New/Delete: " << newTime << " ms" << std::endl;
+    }
+
+    // 14. span本地模式测试：内存碎片化之后构建链表，比较遍历耗时
+    static void testSpanLocal() {
+        constexpr size_t NUM_NODES = 200000;
+
+        std::cout << "\nTesting span-local allocation (" << NUM_NODES
+                  << " list nodes built after random frees):" << std::endl;
+
+        double listTime = benchFragmentedList(NUM_NODES, false);
+        double localTime = benchFragmentedList(NUM_NODES, true);
+
+        std::cout << "Traversal, thread free lists: " << std::fixed << std::setprecision(3) << listTime
+                  << " ms, span-local: " << localTime << " ms" << std::endl;
+    }
+
+    // 15. 碎片测试：随机释放并反复替换对象后，统计仍有存活对象的span占用的内存与存活字节数之比
+    static void testFragmentation() {
+        constexpr size_t SIZE = 200;
+        constexpr size_t NUM_OBJECTS = 400000;
+        constexpr size_t ROUNDS = 20;
+        constexpr size_t CHURN = 20000;
+
+        std::cout << "\nTesting fragmentation (" << NUM_OBJECTS << " objects of " << SIZE
+                  << " bytes, 75% freed, " << ROUNDS << " rounds of " << CHURN << " replacements):" << std::endl;
+
+        std::mt19937 rng(42);
+        std::vector<void*> objects(NUM_OBJECTS);
+        Timer t;
+        for(void*& p : objects) {
+            p = MemoryPool::allocate(SIZE);
+        }
+        std::shuffle(objects.begin(), objects.end(), rng);
+        for(size_t i = NUM_OBJECTS / 4; i < NUM_OBJECTS; ++i) {
+            MemoryPool::deallocate(objects[i], SIZE);
+        }
+        objects.resize(NUM_OBJECTS / 4);
+
+        // 每轮新申请一批对象，再随机释放同样多的对象，存活数量不变
+        for(size_t round = 0; round < ROUNDS; ++round) {
+            for(size_t i = 0; i < CHURN; ++i) {
+                objects.push_back(MemoryPool::allocate(SIZE));
+            }
+            std::shuffle(objects.begin(), objects.end(), rng);
+            for(size_t i = 0; i < CHURN; ++i) {
+                MemoryPool::deallocate(objects.back(), SIZE);
+                objects.pop_back();
+            }
+        }
+        double elapsed = t.elapsed();
+
+        std::vector<SpanInfo*> spans;
+        for(void* p : objects) {
+            spans.push_back(PageMap::get(p));
+        }
+        std::sort(spans.begin(), spans.end());
+        spans.erase(std::unique(spans.begin(), spans.end()), spans.end());
+        size_t spanBytes = 0;
+        for(SpanInfo* span : spans) {
+            spanBytes += span->numPages * 4096;
+        }
+        size_t liveBytes = objects.size() * SIZE;
+
+        std::cout << "Live: " << liveBytes / 1024 << " KB in " << spans.size() << " spans ("
+                  << spanBytes / 1024 << " KB), ratio " << std::fixed << std::setprecision(2)
+                  << static_cast<double>(spanBytes) / liveBytes << ", " << std::setprecision(3)
+                  << elapsed << " ms" << std::endl;
+
+        for(void* p : objects) {
+            MemoryPool::deallocate(p, SIZE);
+        }
+    }
+
+    // 16. 空闲span缓存测试：每个请求申请一批 4KB/8KB 的对象后全部释放，
+    // 中心缓存中的span在完全空闲和重新使用之间反复切换
+    static void testRequestBoundary() {
+        constexpr size_t NUM_REQUESTS = 20000;
+        constexpr size_t PER_REQUEST = 200;
+        const std::array<size_t, 2> sizes = {4096, 8192};
+
+        std::cout << "\nTesting request boundaries (" << NUM_REQUESTS << " requests, "
+                  << PER_REQUEST << " objects of 4KB/8KB each):" << std::endl;
+
+        std::vector<std::pair<void*, size_t>> objects;
+        objects.reserve(PER_REQUEST);
+        auto run = [&](auto alloc, auto release) {
+            Timer t;
+            for(size_t r = 0; r < NUM_REQUESTS; ++r) {
+                for(size_t i = 0; i < PER_REQUEST; ++i) {
+                    size_t size = sizes[(r + i) % sizes.size()];
+                    objects.emplace_back(alloc(size), size);
+                }
+                for(auto& object : objects) {
+                    release(object.first, object.second);
+                }
+                objects.clear();
+            }
+            return t.elapsed();
+        };
+
+        double poolTime = run([](size_t size) { return MemoryPool::allocate(size); },
+                              [](void* p, size_t size) { MemoryPool::deallocate(p, size); });
+        double stdTime = run([](size_t size) { return ::operator new(size); },
+                             [](void* p, size_t) { ::operator delete(p); });
+
+        std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, New/Delete: " << stdTime << " ms" << std::endl;
+    }
+
+    // 17. span尾部浪费测试：中等大小对象各申请一批后查看大小类统计，与固定 8 页的span对比
+    static void testSpanTailWaste() {
+        constexpr size_t NUM_OBJECTS = 2000;
+        const std::array<size_t, 5> sizes = {10000, 12288, 17408, 20480, 24576};
+
+        std::cout << "\nTesting span tail waste (" << NUM_OBJECTS << " objects per size):" << std::endl;
+
+        std::vector<void*> objects;
+        for(size_t size : sizes) {
+            for(size_t i = 0; i < NUM_OBJECTS; ++i) {
+                objects.push_back(MemoryPool::allocate(size));
+            }
+        }
+
+        size_t total = 0;
+        size_t fixedTotal = 0;
+        for(size_t size : sizes) {
+            SizeClassStats stats = MemoryPool::sizeClassStats(size);
+            // 固定 8 页的span能切出的块数和需要的span数
+            size_t fixedBytes = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+            size_t fixedBlocks = fixedBytes / size;
+            size_t fixedWaste = (NUM_OBJECTS + fixedBlocks - 1) / fixedBlocks * (fixedBytes - fixedBlocks * size);
+            total += stats.tailWaste;
+            fixedTotal += fixedWaste;
+            std::cout << std::setw(6) << size << " bytes: " << stats.spanPages << " pages, "
+                      << stats.blocksPerSpan << " blocks/span, " << stats.spans << " spans, tail waste "
+                      << stats.tailWaste / 1024 << " KB (8 pages: " << fixedWaste / 1024 << " KB)" << std::endl;
+        }
+        std::cout << "Total tail waste: " << total / 1024 << " KB (8 pages: " << fixedTotal / 1024 << " KB)" << std::endl;
+
+        for(size_t i = 0; i < objects.size(); ++i) {
+            MemoryPool::deallocate(objects[i], sizes[i / NUM_OBJECTS]);
+        }
+    }
+
+    // 18. 中等对象测试：序列化缓冲区大小在 64KB~256KB 之间随机，同时最多存在 8 个
+    static void testMediumObjects() {
+        constexpr size_t NUM_OPS = 200000;
+        constexpr size_t LIVE = 8;
+
+        std::cout << "\nTesting medium objects (" << NUM_OPS << " buffers of 64KB~256KB, "
+                  << LIVE << " live at a time):" << std::endl;
+
+        std::mt19937 rng(7);
+        std::vector<size_t> sizes(NUM_OPS);
+        for(size_t& size : sizes) {
+            size = 64 * 1024 + rng() % (MAX_BYTES - 64 * 1024 + 1);
+        }
+
+        auto run = [&](auto alloc, auto release) {
+            std::array<std::pair<void*, size_t>, LIVE> live{};
+            Timer t;
+            for(size_t i = 0; i < NUM_OPS; ++i) {
+                auto& slot = live[i % LIVE];
+                if(slot.first) {
+                    release(slot.first, slot.second);
+                }
+                slot = {alloc(sizes[i]), sizes[i]};
+                // 写入首尾，模拟填充缓冲区
+                static_cast<char*>(slot.first)[0] = 1;
+                static_cast<char*>(slot.first)[sizes[i] - 1] = 1;
+            }
+            for(auto& slot : live) {
+                release(slot.first, slot.second);
+            }
+            return t.elapsed();
+        };
+
+        double poolTime = run([](size_t size) { return MemoryPool::allocate(size); },
+                              [](void* p, size_t size) { MemoryPool::deallocate(p, size); });
+        double stdTime = run([](size_t size) { return ::operator new(size); },
+                             [](void* p, size_t) { ::operator delete(p); });
+
+        std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, New/Delete: " << stdTime << " ms" << std::endl;
+    }
+
+    // 19. 大对象测试：反复申请释放 1MB~8MB 的缓冲区并写满每一页
+    static void testLargeObjects() {
+        constexpr size_t NUM_OPS = 2000;
+        constexpr size_t LIVE = 2;
+
+        std::cout << "\nTesting large objects (" << NUM_OPS << " buffers of 1MB~8MB, "
+                  << LIVE << " live at a time):" << std::endl;
+
+        std::mt19937 rng(11);
+        std::vector<size_t> sizes(NUM_OPS);
+        for(size_t& size : sizes) {
+            size = 1024 * 1024 + rng() % (7 * 1024 * 1024 + 1);
+        }
+
+        auto run = [&](auto alloc, auto release) {
+            std::array<std::pair<void*, size_t>, LIVE> live{};
+            Timer t;
+            for(size_t i = 0; i < NUM_OPS; ++i) {
+                auto& slot = live[i % LIVE];
+                if(slot.first) {
+                    release(slot.first, slot.second);
+                }
+                slot = {alloc(sizes[i]), sizes[i]};
+                char* p = static_cast<char*>(slot.first);
+                for(size_t offset = 0; offset < sizes[i]; offset += PageCache::PAGE_SIZE) {
+                    p[offset] = 1;
+                }
+            }
+            for(auto& slot : live) {
+                release(slot.first, slot.second);
+            }
+            return t.elapsed();
+        };
+
+        double poolTime = run([](size_t size) { return MemoryPool::allocate(size); },
+                              [](void* p, size_t size) { MemoryPool::deallocate(p, size); });
+        double stdTime = run([](size_t size) { return ::operator new(size); },
+                             [](void* p, size_t) { ::operator delete(p); });
+
+        std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) << poolTime
+                  << " ms, New/Delete: " << stdTime << " ms" << std::endl;
+    }
+
+    // 20. 页缓存扩展测试：大量新span直接向页缓存申请，再按随机顺序释放
+    static void testPageHeapGrowth() {
+        constexpr size_t NUM_SPANS = 20000;
+
+        std::cout << "\nTesting page heap growth (" << NUM_SPANS << " spans of 1~16 pages):" << std::endl;
+
+        std::mt19937 rng(13);
+        std::vector<std::pair<void*, size_t>> spans(NUM_SPANS);
+        PageCache& pageCache = PageCache::getInstance();
+
+        Timer t;
+        for(auto& span : spans) {
+            span.second = 1 + rng() % 16;
+            span.first = pageCache.allocateSpan(span.second);
+            *static_cast<char*>(span.first) = 1;
+        }
+        double allocTime = t.elapsed();
+
+        std::shuffle(spans.begin(), spans.end(), rng);
+        Timer t2;
+        for(auto& span : spans) {
+            pageCache.deallocateSpan(span.first, span.second);
+        }
+        double freeTime = t2.elapsed();
+
+        std::cout << "Allocate: " << std::fixed << std::setprecision(3) << allocTime
+                  << " ms, free: " << freeTime << " ms" << std::endl;
+    }
+
+    // 21. 大页测试：随机遍历常驻的大型链式索引，比较 4KB 页和透明大页下的 dTLB 未命中
+    static void testHugePageIndex() {
+        struct Node {
+            Node* next;
+            char payload[56];
+        };
+        constexpr size_t NUM_NODES = 2 * 1024 * 1024;
+        constexpr size_t NUM_HOPS = 4 * NUM_NODES;
+
+        std::cout << "\nTesting huge page index (" << NUM_NODES << " nodes of " << sizeof(Node)
+                  << " bytes, " << NUM_HOPS << " random hops):" << std::endl;
+
+        std::mt19937 rng(17);
+        std::vector<size_t> order(NUM_NODES);
+        for(size_t i = 0; i < NUM_NODES; ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+
+        // 两次使用同一批内存块：reserve 预留的span归还后仍留在中心缓存，
+        // 大页模式下 reserve 触发缺页后把它们所在的大页合并为透明大页
+        for(bool huge : {false, true}) {
+            MemoryPool::setHugePages(huge);
+            MemoryPool::reserve({{sizeof(Node), NUM_NODES}});
+
+            std::vector<Node*> nodes(NUM_NODES);
+            for(Node*& node : nodes) {
+                node = static_cast<Node*>(MemoryPool::allocate(sizeof(Node)));
+            }
+            for(size_t i = 0; i < NUM_NODES; ++i) {
+                nodes[order[i]]->next = nodes[order[(i + 1) % NUM_NODES]];
+            }
+            size_t hugeKB = anonHugePagesKB();
+
+            DtlbMissCounter counter;
+            Node* node = nodes[order[0]];
+            counter.start();
+            Timer t;
+            for(size_t i = 0; i < NUM_HOPS; ++i) {
+                node = node->next;
+            }
+            double time = t.elapsed();
+            uint64_t misses = counter.stop();
+            // 防止遍历被优化掉
+            if(!node) {
+                std::cout << "unreachable" << std::endl;
+            }
+
+            std::cout << (huge ? "Huge pages: " : "4KB pages:  ") << std::fixed << std::setprecision(3) << time
+                      << " ms, dTLB misses: ";
+            if(counter.valid()) {
+                std::cout << misses;
+            } else {
+                std::cout << "n/a";
+            }
+            std::cout << ", AnonHugePages: " << hugeKB << " KB" << std::endl;
+
+            for(Node* n : nodes) {
+                MemoryPool::deallocate(n, sizeof(Node));
+            }
+        }
+        MemoryPool::setHugePages(false);
+    }
+
+    // 22. NUMA 放置测试：在每个节点上分配一批 4KB 对象并写入，统计实际位于该节点的页所占比例；
+    // new/delete 的页按首次访问的线程所在节点分配
+    static void testNumaPlacement() {
+        constexpr size_t NUM_OBJECTS = 4096;
+        constexpr size_t SIZE = 4096;
+        size_t nodes = MemoryPool::numaNodeCount();
+
+        std::cout << "\nTesting NUMA placement (" << nodes << " node(s), current node " << MemoryPool::currentNumaNode()
+                  << ", " << NUM_OBJECTS << " objects of 4KB per node):" << std::endl;
+
+        std::vector<void*> ptrs(NUM_OBJECTS);
+        for(size_t node = 0; node < nodes; ++node) {
+            Timer t;
+            for(void*& p : ptrs) {
+                p = MemoryPool::allocateOnNode(SIZE, node);
+                memset(p, 1, SIZE);
+            }
+            double poolTime = t.elapsed();
+            std::string poolPlacement = placementOnNode(ptrs, node);
+            for(void* p : ptrs) {
+                MemoryPool::deallocate(p, SIZE);
+            }
+
+            Timer t2;
+            for(void*& p : ptrs) {
+                p = new char[SIZE];
+                memset(p, 1, SIZE);
+            }
+            double newTime = t2.elapsed();
+            std::string newPlacement = placementOnNode(ptrs, node);
+            for(void* p : ptrs) {
+                delete[] static_cast<char*>(p);
+            }
+
+            std::cout << "Node " << node << ": allocateOnNode " << std::fixed << std::setprecision(3) << poolTime
+                      << " ms, " << poolPlacement << " on node; new/delete " << newTime << " ms, "
+                      << newPlacement << " on node" << std::endl;
+        }
+    }
+
+private:
+    // ptrs 所在页位于 node 上的比例，无法查询页所在节点时为 n/a
+    static std::string placementOnNode(const std::vector<void*>& ptrs, size_t node) {
+        size_t known = 0;
+        size_t onNode = 0;
+        for(void* p : ptrs) {
+            int actual = Numa::pageNode(p);
+            if(actual >= 0) {
+                ++known;
+                onNode += static_cast<size_t>(actual) == node;
+            }
+        }
+        if(known == 0) {
+            return "n/a";
+        }
+        return std::to_string(onNode * 100 / known) + "%";
+    }
+
+    // 进程中由透明大页映射的匿名内存
+    static size_t anonHugePagesKB() {
+        std::ifstream rollup("/proc/self/smaps_rollup");
+        const std::string key = "AnonHugePages:";
+        std::string line;
+        while(std::getline(rollup, line)) {
+            if(line.compare(0, key.size(), key) == 0) {
+                return std::stoul(line.substr(key.size()));
+            }
+        }
+        return 0;
+    }
+
+    // 先申请一批，释放一半后再申请回来，覆盖新内存和回收内存两种情况
+    template <typename AllocFn, typename FreeFn>
+    static double benchZeroed(size_t size, size_t n, AllocFn alloc, FreeFn release) {
+        std::vector<void*> ptrs(n);
+        Timer t;
+        for(size_t i = 0; i < n; ++i) {
+            ptrs[i] = alloc(size);
+        }
+        for(size_t i = 0; i < n; i += 2) {
+            release(ptrs[i], size);
+        }
+        for(size_t i = 0; i < n; i += 2) {
+            ptrs[i] = alloc(size);
+        }
+        for(void* p : ptrs) {
+            release(p, size);
+        }
+        return t.elapsed();
+    }
+
+    // 生产者按批分配并交给消费者释放，队列中最多同时存在 8 批
+    template <typename AllocFn, typename FreeFn>
+    static double benchPipeline(size_t numBatches, size_t batchSize, size_t size, AllocFn alloc, FreeFn release) {
+        std::deque<std::vector<void*>> queue;
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        Timer t;
+        std::thread consumer([&] {
+            for(size_t b = 0; b < numBatches; ++b) {
+                std::vector<void*> batch;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return !queue.empty(); });
+                    batch = std::move(queue.front());
+                    queue.pop_front();
+                }
+                cv.notify_one();
+                for(void* p : batch) {
+                    release(p, size);
+                }
+            }
+        });
+        std::thread producer([&] {
+            for(size_t b = 0; b < numBatches; ++b) {
+                std::vector<void*> batch(batchSize);
+                for(void*& p : batch) {
+                    p = alloc(size);
+                    *static_cast<char*>(p) = 1;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return queue.size() < 8; });
+                    queue.push_back(std::move(batch));
+                }
+                cv.notify_one();
+            }
+        });
+        producer.join();
+        consumer.join();
+        return t.elapsed();
+    }
+
+    struct Node {
+        Node* next;
+        size_t value[7];
+    };
+
+    // 先分配 2n 个节点再按随机顺序释放一半，使空闲内存块在地址上打乱，
+    // 然后在新线程中构建 n 个节点的链表并遍历
+    static double benchFragmentedList(size_t n, bool spanLocal) {
+        std::vector<void*> fragments(n * 2);
+        for(void*& p : fragments) {
+            p = MemoryPool::allocate(sizeof(Node));
+        }
+        std::shuffle(fragments.begin(), fragments.end(), std::mt19937(42));
+        for(size_t i = 0; i < n; ++i) {
+            MemoryPool::deallocate(fragments[i], sizeof(Node));
+        }
+
+        double elapsed = 0.0;
+        std::thread([&] { elapsed = benchListTraversal(n, spanLocal); }).join();
+
+        for(size_t i = n; i < fragments.size(); ++i) {
+            MemoryPool::deallocate(fragments[i], sizeof(Node));
+        }
+        return elapsed;
+    }
+
+    // 构建链表，返回遍历 10 遍的耗时
+    static double benchListTraversal(size_t n, bool spanLocal) {
+        MemoryPool::setSpanLocal(spanLocal);
+        Node* head = nullptr;
+        for(size_t i = 0; i < n; ++i) {
+            Node* node = static_cast<Node*>(MemoryPool::allocate(sizeof(Node)));
+            node->next = head;
+            node->value[0] = i;
+            head = node;
+        }
+
+        Timer t;
+        size_t sum = 0;
+        for(int round = 0; round < 10; ++round) {
+            for(Node* node = head; node; node = node->next) {
+                sum += node->value[0];
+            }
+        }
+        double elapsed = t.elapsed();
+        if(sum != 10 * (n * (n - 1) / 2)) {
+            std::cerr << "list checksum mismatch" << std::endl;
+        }
+
+        while(head) {
+            Node* next = head->next;
+            MemoryPool::deallocate(head, sizeof(Node));
+            head = next;
+        }
+        MemoryPool::setSpanLocal(false);
+        return elapsed;
+    }
+
+    static void runPmrWorkload(std::pmr::memory_resource* resource, size_t n) {
+        std::pmr::map<int, int> m(resource);
+        std::pmr::list<int> l(resource);
+        for(size_t i = 0; i < n; ++i) {
+            m.emplace(static_cast<int>(i), static_cast<int>(i));
+            l.push_back(static_cast<int>(i));
+        }
+        for(size_t i = 0; i < n; i += 2) {
+            m.erase(static_cast<int>(i));
+            l.pop_front();
+        }
+    }
+
+    static double benchPmr(std::pmr::memory_resource* resource, size_t n) {
+        Timer t;
+        runPmrWorkload(resource, n);
+        return t.elapsed();
+    }
+
+    static void printContainerResult(const char* name, double poolTime, double stdTime) {
+        std::cout << name << " PoolAllocator: " << std::fixed << std::setprecision(3)
+                  << poolTime << " ms, std::allocator: " << stdTime << " ms" << std::endl;
+    }
+
+    // 插入后删除一半再重新插入，最后整体析构
+    template <template <typename> class Alloc>
+    static double benchMap(size_t n) {
+        Timer t;
+        {
+            std::map<int, int, std::less<int>, Alloc<std::pair<const int, int>>> m;
+            for(size_t i = 0; i < n; ++i) {
+                m.emplace(static_cast<int>(i), static_cast<int>(i));
+            }
+            for(size_t i = 0; i < n; i += 2) {
+                m.erase(static_cast<int>(i));
+            }
+            for(size_t i = 0; i < n; i += 2) {
+                m.emplace(static_cast<int>(i), static_cast<int>(i));
+            }
+        }
+        return t.elapsed();
+    }
+
+    template <template <typename> class Alloc>
+    static double benchList(size_t n) {
+        Timer t;
+        {
+            std::list<int, Alloc<int>> l;
+            for(size_t i = 0; i < n; ++i) {
+                l.push_back(static_cast<int>(i));
+            }
+            for(auto it = l.begin(); it != l.end();) {
+                it = l.erase(it);
+                if(it != l.end()) {
+                    ++it;
+                }
+            }
+            for(size_t i = 0; i < n / 2; ++i) {
+                l.push_front(static_cast<int>(i));
+            }
+        }
+        return t.elapsed();
+    }
+
+    template <template <typename> class Alloc>
+    static double benchUnorderedMap(size_t n) {
+        Timer t;
+        {
+            std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                               Alloc<std::pair<const int, int>>> m;
+            for(size_t i = 0; i < n; ++i) {
+                m.emplace(static_cast<int>(i), static_cast<int>(i));
+            }
+            for(size_t i = 0; i < n; i += 2) {
+                m.erase(static_cast<int>(i));
+            }
+            for(size_t i = 0; i < n; i += 2) {
+                m.emplace(static_cast<int>(i), static_cast<int>(i));
+            }
+        }
+        return t.elapsed();
+    }
+
+    template <template <typename> class Alloc>
+    static double benchDeque(size_t n) {
+        Timer t;
+        {
+            std::deque<int, Alloc<int>> d;
+            for(size_t i = 0; i < n; ++i) {
+                d.push_back(static_cast<int>(i));
+            }
+            for(size_t i = 0; i < n / 2; ++i) {
+                d.pop_front();
+            }
+            for(size_t i = 0; i < n / 2; ++i) {
+                d.push_front(static_cast<int>(i));
+            }
+        }
+        return t.elapsed();
+    }
 };
 
 int main() {
@@ -438,6 +1381,24 @@ int main() {
     PerformanceTest::testSmallAllocation();
     PerformanceTest::testMultiThreaded();
     PerformanceTest::testMixedSizes();
+    PerformanceTest::testStlContainers();
+    PerformanceTest::testPmrContainers();
+    PerformanceTest::testZeroedAllocation();
+    PerformanceTest::testGrowableBuffer();
+    PerformanceTest::testBatchAllocation();
+    PerformanceTest::testReserve();
+    PerformanceTest::testArena();
+    PerformanceTest::testHeapDestroy();
+    PerformanceTest::testProducerConsumer();
+    PerformanceTest::testSpanLocal();
+    PerformanceTest::testFragmentation();
+    PerformanceTest::testRequestBoundary();
+    PerformanceTest::testSpanTailWaste();
+    PerformanceTest::testMediumObjects();
+    PerformanceTest::testLargeObjects();
+    PerformanceTest::testPageHeapGrowth();
+    PerformanceTest::testHugePageIndex();
+    PerformanceTest::testNumaPlacement();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,329 @@
+// 通过 LD_PRELOAD 替换进程中的 malloc/free 和全局 operator new/delete
+// 用法：LD_PRELOAD=./libmempool_preload.so ./your_program
+#include "MemoryPool.h"
+#include "PageCache.h"
+#include "PageMap.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+
+#define MEMPOOL_EXPORT __attribute__((visibility("default")))
+
+using namespace MemoryPoolv2;
+
+namespace {
+// malloc 必须返回按 alignof(max_align_t) 对齐的地址
+constexpr size_t MIN_ALIGNMENT = 16;
+
+// free 不带大小，每次分配前放一个头部记录实际从内存池申请的地址和大小
+// 头部紧挨在返回给用户的地址之前
+struct AllocHeader {
+    void* raw;
+    size_t total;
+};
+static_assert(sizeof(AllocHeader) == MIN_ALIGNMENT, "header must keep user pointers aligned");
+
+size_t roundUp(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+// alignment 为 2 的幂；zeroed 为 true 时返回的内存全为零
+void* poolAlloc(size_t size, size_t alignment, bool zeroed = false) {
+    // 先限制 alignment，再保证下面计算 total 以及内存池按页向上取整都不会溢出
+    if(alignment > SIZE_MAX / 4) {
+        return nullptr;
+    }
+    size_t overhead = std::max(alignment, sizeof(AllocHeader)) + MIN_ALIGNMENT + PageCache::PAGE_SIZE;
+    if(size > SIZE_MAX - overhead) {
+        return nullptr;
+    }
+
+    // 总大小取 16 的倍数，大小类内存块和 span 的起始地址因此都按 16 对齐
+    size_t total;
+    if(alignment <= MIN_ALIGNMENT) {
+        total = roundUp(size, MIN_ALIGNMENT) + sizeof(AllocHeader);
+    } else {
+        // 头部之后再向上对齐，最多多用 alignment 字节
+        total = roundUp(size, MIN_ALIGNMENT) + alignment;
+    }
+
+    void* raw = zeroed ? MemoryPool::allocateZeroed(total) : MemoryPool::allocate(total);
+    if(!raw) {
+        return nullptr;
+    }
+
+    uintptr_t user = reinterpret_cast<uintptr_t>(raw) + sizeof(AllocHeader);
+    if(alignment > MIN_ALIGNMENT) {
+        user = roundUp(user, alignment);
+    }
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(user) - 1;
+    header->raw = raw;
+    header->total = total;
+    return reinterpret_cast<void*>(user);
+}
+
+AllocHeader* headerOf(void* ptr) {
+    return static_cast<AllocHeader*>(ptr) - 1;
+}
+
+void poolFree(void* ptr) {
+    if(!ptr) {
+        return;
+    }
+    AllocHeader* header = headerOf(ptr);
+    MemoryPool::deallocate(header->raw, header->total);
+}
+
+size_t usableSize(void* ptr) {
+    if(!ptr) {
+        return 0;
+    }
+    AllocHeader* header = headerOf(ptr);
+    return header->total - (static_cast<char*>(ptr) - static_cast<char*>(header->raw));
+}
+
+bool isValidAlignment(size_t alignment) {
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+// fork 时其他线程可能正持有内存池的锁，子进程中只剩调用 fork 的线程，这些锁再也不会被释放。
+// fork 前按与正常路径相同的顺序取得全部锁：先是中心缓存的大小类锁、页缓存的锁，
+// 再是持有时不会获取其他锁的 PageMap、跨线程释放队列回收池和元数据分配器的锁，
+// fork 后在父子进程中按相反顺序释放
+void prepareFork() {
+    CentralCache::lockAll();
+    PageCache::lockAll();
+    PageMap::lockAll();
+    ThreadCache::lockAll();
+    MetadataArena::lockAll();
+}
+
+void afterFork() {
+    MetadataArena::unlockAll();
+    ThreadCache::unlockAll();
+    PageMap::unlockAll();
+    PageCache::unlockAll();
+    CentralCache::unlockAll();
+}
+
+__attribute__((constructor)) void registerForkHandlers() {
+    pthread_atfork(prepareFork, afterFork, afterFork);
+}
+
+void* newImpl(size_t size, size_t alignment) {
+    while(true) {
+        void* p = poolAlloc(size, alignment);
+        if(p) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if(!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* newNothrowImpl(size_t size, size_t alignment) noexcept {
+    try {
+        return newImpl(size, alignment);
+    } catch(...) {
+        return nullptr;
+    }
+}
+} // namespace
+
+extern "C" {
+MEMPOOL_EXPORT void* malloc(size_t size) {
+    void* p = poolAlloc(size, MIN_ALIGNMENT);
+    if(!p) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+MEMPOOL_EXPORT void free(void* ptr) {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void* calloc(size_t num, size_t size) {
+    if(size != 0 && num > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    // 由内存池判断是否需要清零，新映射的内存不会被逐页写一遍
+    void* p = poolAlloc(num * size, MIN_ALIGNMENT, true);
+    if(!p) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+MEMPOOL_EXPORT void* realloc(void* ptr, size_t size) {
+    if(!ptr) {
+        return malloc(size);
+    }
+    if(size == 0) {
+        free(ptr);
+        return nullptr;
+    }
+
+    // 原内存块的剩余空间足够、且缩小后仍用到一半以上时原地返回，避免在相近的大小间反复调整时来回拷贝
+    size_t oldSize = usableSize(ptr);
+    if(size <= oldSize && size >= oldSize / 2) {
+        return ptr;
+    }
+
+    // 头部紧挨在原始地址之后（没有额外对齐）时交给 MemoryPool::reallocate，
+    // 可以原地扩大或缩小span、使用 mremap，缩小到更小的大小类时换用小内存块
+    AllocHeader* header = headerOf(ptr);
+    if(static_cast<char*>(ptr) - static_cast<char*>(header->raw) == sizeof(AllocHeader)) {
+        if(size > SIZE_MAX - 2 * PageCache::PAGE_SIZE) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+        size_t total = roundUp(size, MIN_ALIGNMENT) + sizeof(AllocHeader);
+        void* raw = MemoryPool::reallocate(header->raw, header->total, total);
+        if(!raw) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+        header = static_cast<AllocHeader*>(raw);
+        header->raw = raw;
+        header->total = total;
+        return header + 1;
+    }
+
+    void* p = malloc(size);
+    if(p) {
+        memcpy(p, ptr, std::min(oldSize, size));
+        free(ptr);
+    }
+    return p;
+}
+
+MEMPOOL_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t size) {
+    if(!isValidAlignment(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+    void* p = poolAlloc(size, alignment);
+    if(!p) {
+        return ENOMEM;
+    }
+    *memptr = p;
+    return 0;
+}
+
+MEMPOOL_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    if(!isValidAlignment(alignment)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    void* p = poolAlloc(size, alignment);
+    if(!p) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+MEMPOOL_EXPORT void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+MEMPOOL_EXPORT void* valloc(size_t size) {
+    return aligned_alloc(PageCache::PAGE_SIZE, size);
+}
+
+MEMPOOL_EXPORT void* pvalloc(size_t size) {
+    return aligned_alloc(PageCache::PAGE_SIZE, roundUp(size, PageCache::PAGE_SIZE));
+}
+
+MEMPOOL_EXPORT size_t malloc_usable_size(void* ptr) {
+    return usableSize(ptr);
+}
+} // extern "C"
+
+// 全局 operator new/delete
+// 带大小和对齐参数的 delete 也统一通过头部释放，大小参数只作为提示
+MEMPOOL_EXPORT void* operator new(size_t size) {
+    return newImpl(size, MIN_ALIGNMENT);
+}
+
+MEMPOOL_EXPORT void* operator new[](size_t size) {
+    return newImpl(size, MIN_ALIGNMENT);
+}
+
+MEMPOOL_EXPORT void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return newNothrowImpl(size, MIN_ALIGNMENT);
+}
+
+MEMPOOL_EXPORT void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return newNothrowImpl(size, MIN_ALIGNMENT);
+}
+
+MEMPOOL_EXPORT void* operator new(size_t size, std::align_val_t alignment) {
+    return newImpl(size, static_cast<size_t>(alignment));
+}
+
+MEMPOOL_EXPORT void* operator new[](size_t size, std::align_val_t alignment) {
+    return newImpl(size, static_cast<size_t>(alignment));
+}
+
+MEMPOOL_EXPORT void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return newNothrowImpl(size, static_cast<size_t>(alignment));
+}
+
+MEMPOOL_EXPORT void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return newNothrowImpl(size, static_cast<size_t>(alignment));
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr, size_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr, size_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr, std::align_val_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr, std::align_val_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    poolFree(ptr);
+}
+
+MEMPOOL_EXPORT void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    poolFree(ptr);
+}
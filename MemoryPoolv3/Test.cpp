@@ -1,12 +1,33 @@
 #include "MemoryPool.h"
+#include "PoolAllocator.h"
+#include "PmrResource.h"
+#include "PoolBuffer.h"
+#include "Arena.h"
+#include "Heap.h"
+#include "CentralCache.h"
+#include "PageCache.h"
+#include "PageMap.h"
+#include "Numa.h"
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <chrono>
 #include <cassert>
 #include <cstring>
 #include <random>
 #include <algorithm>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <list>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <cstdint>
+#include <cstdlib>
 
 using namespace MemoryPoolv2;
 
@@ -182,12 +203,1272 @@ void testStress() {
     std::cout << "Stress test passed!" << std::endl;
 }
 
+// 标准库容器测试
+void testPoolAllocator() {
+    std::cout << "Running pool allocator test..." << std::endl;
+
+    // 节点型容器，rebind 到内部节点类型
+    std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int>>> m;
+    std::list<int, PoolAllocator<int>> l;
+    for(int i = 0; i < 1000; ++i) {
+        m[i] = i * 2;
+        l.push_back(i);
+    }
+    for(int i = 0; i < 1000; ++i) {
+        assert(m[i] == i * 2);
+    }
+
+    // 连续内存容器，覆盖多个对象一起分配以及超过 MAX_BYTES 的情况
+    std::vector<size_t, PoolAllocator<size_t>> v;
+    for(size_t i = 0; i < MAX_BYTES / sizeof(size_t) + 1; ++i) {
+        v.push_back(i);
+    }
+    for(size_t i = 0; i < v.size(); ++i) {
+        assert(v[i] == i);
+    }
+
+    // 无状态分配器，不同类型的实例相等
+    assert(PoolAllocator<int>() == PoolAllocator<double>());
+
+    std::cout << "Pool allocator test passed!" << std::endl;
+}
+
+// std::pmr 资源测试
+void testPmrResource() {
+    std::cout << "Running pmr resource test..." << std::endl;
+
+    std::pmr::memory_resource* resource = poolResource();
+
+    // 对齐要求：天然对齐的大小类、超过 MAX_BYTES 的大对象
+    for(size_t alignment : {8, 16, 64, 256, 4096}) {
+        for(size_t bytes : {size_t(1), size_t(100), size_t(3000), MAX_BYTES + 1}) {
+            void* p = resource->allocate(bytes, alignment);
+            assert(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+            memset(p, 0xAB, bytes);
+            resource->deallocate(p, bytes, alignment);
+        }
+    }
+
+    std::pmr::map<int, int> m(resource);
+    for(int i = 0; i < 1000; ++i) {
+        m[i] = i;
+    }
+    assert(m.size() == 1000);
+
+    // 单调资源：片段按需增长，超过片段大小的请求单独成片
+    {
+        MonotonicPoolResource monotonic;
+        std::pmr::list<int> l(&monotonic);
+        for(int i = 0; i < 10000; ++i) {
+            l.push_back(i);
+        }
+        void* big = monotonic.allocate(MAX_BYTES * 2, 64);
+        assert(reinterpret_cast<uintptr_t>(big) % 64 == 0);
+        memset(big, 0, MAX_BYTES * 2);
+        assert(l.size() == 10000);
+
+        // 超大请求不能因计算溢出而在当前片段中"分配成功"
+        bool thrown = false;
+        try {
+            (void)monotonic.allocate(SIZE_MAX - 8, 8);
+        } catch(const std::bad_alloc&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    std::cout << "Pmr resource test passed!" << std::endl;
+}
+
+// reallocate 测试
+void testReallocate() {
+    std::cout << "Running reallocate test..." << std::endl;
+
+    // 同一大小类内调整，原地返回
+    char* p = static_cast<char*>(MemoryPool::allocate(17));
+    memset(p, 0x11, 17);
+    assert(MemoryPool::reallocate(p, 17, 24) == p);
+
+    // 跨大小类时数据被保留，逐步增长直到超过 MAX_BYTES
+    size_t size = 24;
+    while(size <= 4 * MAX_BYTES) {
+        size_t newSize = size * 2;
+        p = static_cast<char*>(MemoryPool::reallocate(p, size, newSize));
+        assert(p != nullptr);
+        for(size_t i = 0; i < 17; ++i) {
+            assert(p[i] == 0x11);
+        }
+        assert(p[size - 1] == 0x22 || size == 24);
+        p[newSize - 1] = 0x22;
+        size = newSize;
+    }
+
+    // 大对象缩小
+    p = static_cast<char*>(MemoryPool::reallocate(p, size, MAX_BYTES + 1));
+    assert(p[0] == 0x11);
+    size = MAX_BYTES + 1;
+
+    // 从大对象缩回大小类
+    p = static_cast<char*>(MemoryPool::reallocate(p, size, 100));
+    assert(p[16] == 0x11);
+    MemoryPool::deallocate(p, 100);
+
+    // 独占span的内存块扩大后仍可正常释放和复用
+    size_t spanSize = 40 * 1024;
+    std::vector<void*> blocks;
+    for(int i = 0; i < 16; ++i) {
+        void* q = MemoryPool::allocate(spanSize);
+        memset(q, i, spanSize);
+        q = MemoryPool::reallocate(q, spanSize, 2 * spanSize);
+        assert(static_cast<unsigned char*>(q)[spanSize - 1] == static_cast<unsigned char>(i));
+        memset(q, i, 2 * spanSize);
+        blocks.push_back(q);
+    }
+    for(void* q : blocks) {
+        MemoryPool::deallocate(q, 2 * spanSize);
+    }
+
+    void* fresh = MemoryPool::reallocate(nullptr, 0, 64);
+    assert(fresh != nullptr);
+    assert(MemoryPool::reallocate(fresh, 64, 0) == nullptr);
+
+    std::cout << "Reallocate test passed!" << std::endl;
+}
+
+// allocateZeroed 测试：新内存和回收再利用的内存都必须全为零
+void testAllocateZeroed() {
+    std::cout << "Running zeroed allocation test..." << std::endl;
+
+    auto isZero = [](const void* p, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(p);
+        return std::all_of(bytes, bytes + size, [](unsigned char b) { return b == 0; });
+    };
+
+    for(size_t size : {size_t(1), size_t(24), size_t(1000), size_t(40 * 1024), size_t(100 * 1024 + 3), MAX_BYTES + 100}) {
+        // 多轮申请、写脏、释放，保证后续申请拿到的是回收的内存块
+        for(int round = 0; round < 3; ++round) {
+            std::vector<void*> ptrs;
+            for(int i = 0; i < 8; ++i) {
+                void* p = MemoryPool::allocateZeroed(size);
+                assert(p != nullptr);
+                assert(isZero(p, size));
+                memset(p, 0xCD, size);
+                ptrs.push_back(p);
+            }
+            for(void* p : ptrs) {
+                MemoryPool::deallocate(p, size);
+            }
+        }
+    }
+
+    std::cout << "Zeroed allocation test passed!" << std::endl;
+}
+
+// 对齐分配测试
+void testAllocateAligned() {
+    std::cout << "Running aligned allocation test..." << std::endl;
+
+    for(size_t alignment : {8, 16, 32, 64, 4096, 8192, 64 * 1024}) {
+        std::vector<std::pair<void*, size_t>> ptrs;
+        for(size_t size : {size_t(0), size_t(1), size_t(24), size_t(100), size_t(5000),
+                           size_t(40 * 1024), MAX_BYTES, MAX_BYTES + 1}) {
+            for(int i = 0; i < 4; ++i) {
+                void* p = MemoryPool::allocateAligned(size, alignment);
+                assert(p != nullptr);
+                assert(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+                memset(p, 0x5A, size);
+                ptrs.emplace_back(p, size);
+            }
+        }
+        for(const auto& [p, size] : ptrs) {
+            MemoryPool::deallocateAligned(p, size, alignment);
+        }
+    }
+
+    // 对齐必须是 2 的幂
+    assert(MemoryPool::allocateAligned(64, 24) == nullptr);
+
+    // 超过 max_align_t 对齐的类型可以直接用于 PoolAllocator
+    struct alignas(64) CacheLineCounter {
+        size_t value;
+    };
+    std::vector<CacheLineCounter, PoolAllocator<CacheLineCounter>> counters(100);
+    assert(reinterpret_cast<uintptr_t>(counters.data()) % 64 == 0);
+    std::list<CacheLineCounter, PoolAllocator<CacheLineCounter>> l(10);
+    for(const auto& c : l) {
+        assert(reinterpret_cast<uintptr_t>(&c) % 64 == 0);
+    }
+
+    std::cout << "Aligned allocation test passed!" << std::endl;
+}
+
+// allocateAtLeast 与 PoolBuffer 测试
+void testAllocateAtLeast() {
+    std::cout << "Running allocate-at-least test..." << std::endl;
+
+    for(size_t size : {size_t(0), size_t(1), size_t(13), size_t(1000), size_t(20 * 1024),
+                       size_t(33 * 1024), size_t(100 * 1024 + 1), MAX_BYTES, MAX_BYTES + 1}) {
+        AllocationResult result = MemoryPool::allocateAtLeast(size);
+        assert(result.ptr != nullptr);
+        assert(result.size >= size);
+        assert(result.size == MemoryPool::usableSize(size));
+        // 整个可用大小都可以写入，并按可用大小释放
+        memset(result.ptr, 0x3C, result.size);
+        MemoryPool::deallocate(result.ptr, result.size);
+    }
+
+    PoolAllocator<int> alloc;
+    allocation_result<int*> ints = alloc.allocate_at_least(5000);
+    assert(ints.count >= 5000);
+    for(size_t i = 0; i < ints.count; ++i) {
+        ints.ptr[i] = static_cast<int>(i);
+    }
+    alloc.deallocate(ints.ptr, ints.count);
+
+    // 缓冲区容量总是等于实际可用大小
+    PoolBuffer buffer;
+    std::string expected;
+    for(int i = 0; i < 100000; ++i) {
+        std::string piece = std::to_string(i);
+        buffer.append(piece.data(), piece.size());
+        expected += piece;
+        assert(buffer.capacity() == MemoryPool::usableSize(buffer.capacity()));
+    }
+    buffer.push_back('!');
+    expected.push_back('!');
+    assert(buffer.size() == expected.size());
+    assert(memcmp(buffer.data(), expected.data(), expected.size()) == 0);
+
+    PoolBuffer moved(std::move(buffer));
+    assert(buffer.data() == nullptr && moved.size() == expected.size());
+
+    std::cout << "Allocate-at-least test passed!" << std::endl;
+}
+
+// 批量分配释放测试
+void testBatch() {
+    std::cout << "Running batch allocation test..." << std::endl;
+
+    constexpr size_t NUM_BLOCKS = 10000;
+    std::vector<void*> ptrs(NUM_BLOCKS);
+    for(size_t size : {size_t(16), size_t(200), size_t(40 * 1024), MAX_BYTES + 1}) {
+        size_t n = size > 1024 ? 64 : NUM_BLOCKS;
+        for(int round = 0; round < 3; ++round) {
+            // 线程缓存中先放入少量内存块，覆盖本地链表和中心缓存两条路径
+            void* local = MemoryPool::allocate(size);
+            MemoryPool::deallocate(local, size);
+
+            size_t count = MemoryPool::allocateBatch(size, n, ptrs.data());
+            assert(count == n);
+            for(size_t i = 0; i < n; ++i) {
+                memset(ptrs[i], static_cast<int>(i & 0xFF), size);
+            }
+            // 没有重复的内存块
+            std::vector<void*> sorted(ptrs.begin(), ptrs.begin() + n);
+            std::sort(sorted.begin(), sorted.end());
+            assert(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+            for(size_t i = 0; i < n; ++i) {
+                assert(*static_cast<unsigned char*>(ptrs[i]) == (i & 0xFF));
+            }
+            MemoryPool::deallocateBatch(ptrs.data(), n, size);
+        }
+    }
+
+    std::cout << "Batch allocation test passed!" << std::endl;
+}
+
+// 预留与线程预热测试
+void testReserve() {
+    std::cout << "Running reserve test..." << std::endl;
+
+    MemoryPool::reserve({{72, 5000}, {6000, 100}, {50 * 1024, 8}, {MAX_BYTES + 1, 1}});
+    MemoryPool::reserve({{72, 100}}, false);
+
+    std::thread worker([] {
+        MemoryPool::warmUpThread({{72, 32}, {6000, 1000}});
+        std::vector<void*> ptrs;
+        for(int i = 0; i < 5000; ++i) {
+            void* p = MemoryPool::allocate(72);
+            memset(p, 0x7E, 72);
+            ptrs.push_back(p);
+        }
+        for(void* p : ptrs) {
+            MemoryPool::deallocate(p, 72);
+        }
+        void* big = MemoryPool::allocateZeroed(50 * 1024);
+        assert(static_cast<char*>(big)[50 * 1024 - 1] == 0);
+        MemoryPool::deallocate(big, 50 * 1024);
+    });
+    worker.join();
+
+    std::cout << "Reserve test passed!" << std::endl;
+}
+
+// Arena 测试
+void testArena() {
+    std::cout << "Running arena test..." << std::endl;
+
+    Arena arena(4096);
+    for(size_t alignment : {1, 8, 64, 4096}) {
+        void* p = arena.allocate(100, alignment);
+        assert(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+        memset(p, 0x42, 100);
+    }
+
+    // 回退到标记处后，之后的分配复用同一段内存
+    Arena::Marker marker = arena.mark();
+    void* first = arena.allocate(64);
+    size_t capacity = arena.capacity();
+    for(int i = 0; i < 10000; ++i) {
+        memset(arena.allocate(100), 0x24, 100);
+    }
+    assert(arena.capacity() > capacity);
+    arena.rewind(marker);
+    assert(arena.capacity() == capacity);
+    assert(arena.allocate(64) == first);
+
+    // 超过片段大小的请求单独成片
+    void* big = arena.allocate(MAX_BYTES * 4);
+    memset(big, 0, MAX_BYTES * 4);
+
+    // 超大请求不能因计算溢出而在当前片段中"分配成功"
+    bool thrown = false;
+    try {
+        arena.allocate(SIZE_MAX - 8, 8);
+    } catch(const std::bad_alloc&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    arena.reset();
+    assert(arena.capacity() > 0);
+
+    // 标准库容器和 pmr 容器
+    {
+        std::vector<int, ArenaAllocator<int>> v{ArenaAllocator<int>(arena)};
+        std::map<int, int, std::less<int>, ArenaAllocator<std::pair<const int, int>>> m{ArenaAllocator<std::pair<const int, int>>(arena)};
+        std::pmr::list<int> l(&arena);
+        for(int i = 0; i < 1000; ++i) {
+            v.push_back(i);
+            m[i] = i;
+            l.push_back(i);
+        }
+        assert(v.size() == 1000 && m.size() == 1000 && l.size() == 1000);
+    }
+
+    arena.release();
+    assert(arena.capacity() == 0);
+    assert(arena.create<int>(7) != nullptr);
+
+    std::cout << "Arena test passed!" << std::endl;
+}
+
+// 独立堆测试
+void testHeap() {
+    std::cout << "Running heap test..." << std::endl;
+
+    Heap tenantA;
+    Heap tenantB;
+
+    // 多线程在两个堆上交替分配，一半对象交给主线程释放
+    struct Allocation {
+        Heap* heap;
+        void* ptr;
+        size_t size;
+    };
+    std::vector<Allocation> handedOff;
+    std::mutex handedOffMutex;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            std::vector<Allocation> local;
+            for(int i = 0; i < 20000; ++i) {
+                Heap* heap = (i & 1) ? &tenantA : &tenantB;
+                size_t size = (i % 1000 == 0) ? MAX_BYTES + rng() % 10000 : rng() % 2000 + 1;
+                void* p = heap->allocate(size);
+                assert(p != nullptr);
+                memset(p, t, std::min(size, size_t(64)));
+                local.push_back({heap, p, size});
+            }
+            for(size_t i = 0; i < local.size(); ++i) {
+                if(i % 2 == 0) {
+                    local[i].heap->deallocate(local[i].ptr, local[i].size);
+                } else {
+                    std::lock_guard<std::mutex> lock(handedOffMutex);
+                    handedOff.push_back(local[i]);
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    for(const Allocation& a : handedOff) {
+        if(a.heap == &tenantB) {
+            a.heap->deallocate(a.ptr, a.size);
+        }
+    }
+    assert(tenantA.capacity() > 0);
+
+    // 租户 A 下线：剩余对象不逐个释放，整体销毁
+    tenantA.destroy();
+    assert(tenantA.capacity() == 0);
+
+    // 销毁后的堆可以继续使用，其他线程中旧的缓存不会被误用
+    std::thread reuse([&] {
+        for(int i = 0; i < 1000; ++i) {
+            void* p = tenantA.allocate(64);
+            memset(p, 0x11, 64);
+            tenantA.deallocate(p, 64);
+        }
+    });
+    reuse.join();
+    tenantB.destroy();
+
+    // 其他线程析构堆后，本线程中该堆的缓存在槽位被占用时被丢弃；
+    // 析构的堆的控制块被新的堆复用，id 不同，不会把旧内存块还给新的堆
+    std::atomic<int> phase{0};
+    Heap* temporary = new Heap;
+    std::thread stale([&] {
+        void* p = temporary->allocate(64);
+        temporary->deallocate(p, 64);
+        phase.store(1);
+        while(phase.load() != 2) {
+            std::this_thread::yield();
+        }
+        std::vector<Heap*> heaps;
+        for(int i = 0; i < 4; ++i) {
+            heaps.push_back(new Heap);
+            void* q = heaps.back()->allocate(64);
+            heaps.back()->deallocate(q, 64);
+        }
+        for(Heap* heap : heaps) {
+            assert(heap->capacity() > 0);
+            delete heap;
+        }
+    });
+    while(phase.load() != 1) {
+        std::this_thread::yield();
+    }
+    delete temporary;
+    phase.store(2);
+    stale.join();
+
+    std::cout << "Heap test passed!" << std::endl;
+}
+
+// 跨线程释放测试：消费者线程释放的内存块应回到分配它的生产者线程
+void testRemoteFree() {
+    std::cout << "Running remote free test..." << std::endl;
+
+    // 选一个前面的测试没有用过的大小类，保证内存块都来自生产者切分的span
+    constexpr size_t BLOCK_SIZE = 2568;
+    constexpr int ROUNDS = 20;
+    constexpr size_t PER_ROUND = 1000;
+
+    std::vector<void*> handoff;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready = false;
+    bool consumed = false;
+    size_t reused = 0;
+    // 生产者线程的跨线程释放队列，用第一个内存块所在span的所有者识别
+    RemoteFreeQueue* producerOwner = nullptr;
+
+    std::thread consumer([&] {
+        for(int round = 0; round < ROUNDS; ++round) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return ready; });
+            for(void* p : handoff) {
+                // 校验生产者写入的内容
+                assert(*static_cast<unsigned char*>(p) == static_cast<unsigned char>(round));
+                MemoryPool::deallocate(p, BLOCK_SIZE);
+            }
+            // 生产者切分的span中的内存块已交还生产者，不会留在消费者的线程缓存中；
+            // 消费者自己切分的span可能被生产者分到，这些内存块回到消费者是预期行为
+            void* own = MemoryPool::allocate(BLOCK_SIZE);
+            assert(std::find(handoff.begin(), handoff.end(), own) == handoff.end()
+                   || PageMap::get(own)->owner != producerOwner);
+            MemoryPool::deallocate(own, BLOCK_SIZE);
+            handoff.clear();
+            ready = false;
+            consumed = true;
+            cv.notify_all();
+        }
+    });
+
+    std::thread producer([&] {
+        std::vector<void*> previous;
+        for(int round = 0; round < ROUNDS; ++round) {
+            std::vector<void*> blocks;
+            for(size_t i = 0; i < PER_ROUND; ++i) {
+                void* p = MemoryPool::allocate(BLOCK_SIZE);
+                assert(p != nullptr);
+                memset(p, round, BLOCK_SIZE);
+                blocks.push_back(p);
+            }
+            // 上一轮交给消费者的内存块应被本线程重新取回
+            std::sort(previous.begin(), previous.end());
+            for(void* p : blocks) {
+                reused += std::binary_search(previous.begin(), previous.end(), p);
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if(round == 0) {
+                producerOwner = PageMap::get(blocks.front())->owner;
+                assert(producerOwner != nullptr);
+            }
+            handoff = blocks;
+            previous = blocks;
+            ready = true;
+            consumed = false;
+            cv.notify_all();
+            cv.wait(lock, [&] { return consumed; });
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    assert(reused >= (ROUNDS - 1) * PER_ROUND / 2);
+
+    // 所有者退出后，其他线程释放它的内存块在本地回收
+    std::vector<void*> orphans;
+    std::thread shortLived([&] {
+        for(int i = 0; i < 100; ++i) {
+            orphans.push_back(MemoryPool::allocate(BLOCK_SIZE));
+        }
+    });
+    shortLived.join();
+    for(void* p : orphans) {
+        MemoryPool::deallocate(p, BLOCK_SIZE);
+    }
+    void* p = MemoryPool::allocate(BLOCK_SIZE);
+    assert(p != nullptr);
+    MemoryPool::deallocate(p, BLOCK_SIZE);
+
+    std::cout << "Remote free test passed!" << std::endl;
+}
+
+// span本地模式测试：连续分配集中在同一span中，释放的内存块回到所在span
+void testSpanLocal() {
+    std::cout << "Running span-local mode test..." << std::endl;
+
+    // 选一个前面的测试没有用过的大小类，每个span切出 32KB / 1096 = 29 块
+    constexpr size_t BLOCK_SIZE = 1096;
+    constexpr size_t PER_SPAN = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE / BLOCK_SIZE;
+    constexpr size_t COUNT = PER_SPAN * 4;
+
+    std::thread worker([&] {
+        MemoryPool::setSpanLocal(true);
+        std::vector<void*> blocks;
+        std::vector<SpanInfo*> spans;
+        for(size_t i = 0; i < COUNT; ++i) {
+            void* p = MemoryPool::allocate(BLOCK_SIZE);
+            assert(p != nullptr);
+            memset(p, 0x5a, BLOCK_SIZE);
+            blocks.push_back(p);
+            SpanInfo* span = PageMap::get(p);
+            assert(span != nullptr);
+            if(spans.empty() || spans.back() != span) {
+                spans.push_back(span);
+            }
+        }
+        // 每个span用完才换下一个
+        assert(spans.size() == COUNT / PER_SPAN);
+
+        // 释放后除当前span外，其余span的内存块全部回到span中
+        for(void* p : blocks) {
+            MemoryPool::deallocate(p, BLOCK_SIZE);
+        }
+        for(size_t i = 0; i + 1 < spans.size(); ++i) {
+            assert(spans[i]->freeCount == spans[i]->totalBlocks);
+        }
+
+        // 批量分配同样逐个span用完，批量释放的内存块回到所在span
+        assert(MemoryPool::allocateBatch(BLOCK_SIZE, COUNT, blocks.data()) == COUNT);
+        spans.clear();
+        for(void* p : blocks) {
+            SpanInfo* span = PageMap::get(p);
+            if(spans.empty() || spans.back() != span) {
+                spans.push_back(span);
+            }
+        }
+        assert(spans.size() == COUNT / PER_SPAN);
+        MemoryPool::deallocateBatch(blocks.data(), COUNT, BLOCK_SIZE);
+        for(size_t i = 0; i + 1 < spans.size(); ++i) {
+            assert(spans[i]->freeCount == spans[i]->totalBlocks);
+        }
+
+        // 关闭后按常规方式继续分配
+        MemoryPool::setSpanLocal(false);
+        assert(spans.back()->freeCount == spans.back()->totalBlocks);
+        void* p = MemoryPool::allocate(BLOCK_SIZE);
+        assert(p != nullptr);
+        MemoryPool::deallocate(p, BLOCK_SIZE);
+    });
+    worker.join();
+
+    std::cout << "Span-local mode test passed!" << std::endl;
+}
+
+// 中心缓存总是从最满的span分配：几乎空闲的span不再被取用，有机会全部空闲
+void testFullestSpan() {
+    std::cout << "Running fullest span test..." << std::endl;
+
+    // 选一个前面的测试没有用过的大小类，每个span切出 32KB / 3080 = 10 块
+    constexpr size_t BLOCK_SIZE = 3080;
+    constexpr size_t INDEX = BLOCK_SIZE / ALIGNMENT - 1;
+    constexpr size_t PER_SPAN = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE / BLOCK_SIZE;
+    CentralCache& central = CentralCache::getInstance();
+
+    // 取走两个新span的全部内存块
+    std::vector<void*> blocks;
+    for(int i = 0; i < 2; ++i) {
+        for(void* p = central.fetchRange(INDEX, PER_SPAN); p; p = *static_cast<void**>(p)) {
+            blocks.push_back(p);
+        }
+    }
+    assert(blocks.size() == 2 * PER_SPAN);
+    SpanInfo* full = PageMap::get(blocks.front());
+    SpanInfo* sparse = PageMap::get(blocks.back());
+    assert(full != sparse);
+
+    auto giveBack = [&](void* p) {
+        *static_cast<void**>(p) = nullptr;
+        central.returnRange(p, 1, INDEX);
+    };
+    // full 只归还一块，sparse 只留一块；sparse 后归还，按链表头取的话会先取到它
+    giveBack(blocks.front());
+    for(size_t i = PER_SPAN + 1; i < 2 * PER_SPAN; ++i) {
+        giveBack(blocks[i]);
+    }
+    assert(sparse->freeCount == PER_SPAN - 1);
+
+    void* p = central.fetchRange(INDEX, 1);
+    assert(PageMap::get(p) == full);
+    assert(sparse->freeCount == PER_SPAN - 1);
+
+    // 全部归还后两个span都完全空闲
+    giveBack(p);
+    for(size_t i = 1; i <= PER_SPAN; ++i) {
+        giveBack(blocks[i]);
+    }
+    assert(full->freeCount == full->totalBlocks);
+    assert(sparse->freeCount == sparse->totalBlocks);
+
+    std::cout << "Fullest span test passed!" << std::endl;
+}
+
+// 完全空闲的span先缓存在中心缓存中，超出上限或空闲太久才归还页缓存
+void testEmptySpanCache() {
+    std::cout << "Running empty span cache test..." << std::endl;
+
+    // 选一个前面的测试没有用过的大小类，每个span切出 32KB / 3592 = 9 块
+    constexpr size_t BLOCK_SIZE = 3592;
+    constexpr size_t INDEX = BLOCK_SIZE / ALIGNMENT - 1;
+    constexpr size_t SPAN_BYTES = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+    constexpr size_t PER_SPAN = SPAN_BYTES / BLOCK_SIZE;
+    constexpr size_t CACHED = CentralCache::EMPTY_SPAN_BYTES / SPAN_BYTES;
+    CentralCache& central = CentralCache::getInstance();
+
+    auto fetchSpans = [&](size_t numSpans) {
+        std::vector<void*> blocks;
+        for(size_t i = 0; i < numSpans; ++i) {
+            for(void* p = central.fetchRange(INDEX, PER_SPAN); p; p = *static_cast<void**>(p)) {
+                blocks.push_back(p);
+            }
+        }
+        assert(blocks.size() == numSpans * PER_SPAN);
+        return blocks;
+    };
+    auto giveBack = [&](void* p) {
+        *static_cast<void**>(p) = nullptr;
+        central.returnRange(p, 1, INDEX);
+    };
+    // 仍登记在 PageMap 中的span数
+    auto mappedSpans = [](const std::vector<void*>& starts) {
+        return std::count_if(starts.begin(), starts.end(), [](void* start) { return PageMap::get(start) != nullptr; });
+    };
+
+    // 在span边界上来回波动：全部释放后再申请，拿到的仍是同一个span，不必重新切分
+    std::vector<void*> blocks = fetchSpans(1);
+    SpanInfo* span = PageMap::get(blocks.front());
+    for(void* p : blocks) {
+        giveBack(p);
+    }
+    assert(PageMap::get(blocks.front()) == span);
+    assert(span->freeCount == span->totalBlocks);
+    for(void* p : fetchSpans(1)) {
+        assert(PageMap::get(p) == span);
+        giveBack(p);
+    }
+
+    // 缓存有上限：超出的span中最早空闲的立即归还
+    blocks = fetchSpans(CACHED + 2);
+    std::vector<void*> starts;
+    for(void* p : blocks) {
+        starts.push_back(PageMap::get(p)->start);
+    }
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    assert(starts.size() == CACHED + 2);
+
+    void* last = blocks.back();
+    blocks.pop_back();
+    for(void* p : blocks) {
+        giveBack(p);
+    }
+    // last 所在的span不空闲，其余 CACHED + 1 个空闲span中有一个被归还
+    assert(mappedSpans(starts) == CACHED + 1);
+
+    // 空闲超过 EMPTY_SPAN_DELAY 的span在该大小类下一次有span变为空闲时归还，刚变为空闲的span保留
+    std::this_thread::sleep_for(CentralCache::EMPTY_SPAN_DELAY + std::chrono::milliseconds(50));
+    SpanInfo* lastSpan = PageMap::get(last);
+    giveBack(last);
+    assert(mappedSpans(starts) == 1);
+    assert(PageMap::get(last) == lastSpan);
+
+    // 之后不再有span变为空闲时，空闲太久的span在下一次从该大小类取内存块时归还
+    blocks = fetchSpans(2);
+    starts.clear();
+    for(void* p : blocks) {
+        starts.push_back(PageMap::get(p)->start);
+    }
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    assert(starts.size() == 2);
+    for(void* p : blocks) {
+        giveBack(p);
+    }
+    assert(mappedSpans(starts) == 2);
+    std::this_thread::sleep_for(CentralCache::EMPTY_SPAN_DELAY + std::chrono::milliseconds(50));
+    void* fresh = central.fetchRange(INDEX, 1);
+    assert(mappedSpans(starts) == 1);
+    giveBack(fresh);
+
+    // 每个大小类的空闲span都在本类上限以内，但不再使用的大小类不会再检查自己的空闲span；
+    // 所有大小类的总量超过 MAX_EMPTY_BYTES 时由归还内存块的线程跨大小类归还
+    // 选前面的测试没有用过的独占span的大小类，每类缓存满 EMPTY_SPAN_BYTES
+    constexpr size_t PAGE = PageCache::PAGE_SIZE;
+    std::vector<size_t> classes;
+    for(size_t size = 64 * 1024; classes.size() * CentralCache::EMPTY_SPAN_BYTES <= 2 * CentralCache::MAX_EMPTY_BYTES; size += PAGE) {
+        size_t index = size / ALIGNMENT - 1;
+        if(size <= MAX_BYTES && central.getStats(index).spans == 0) {
+            classes.push_back(index);
+        }
+        assert(size <= MAX_BYTES);
+    }
+    for(size_t index : classes) {
+        std::vector<void*> large;
+        for(size_t cached = 0; cached < CentralCache::EMPTY_SPAN_BYTES; cached += CentralCache::classSpanPages(index) * PAGE) {
+            large.push_back(central.fetchRange(index, 1));
+        }
+        for(void* p : large) {
+            *static_cast<void**>(p) = nullptr;
+            central.returnRange(p, 1, index);
+        }
+    }
+    size_t emptyBytes = 0;
+    for(size_t index : classes) {
+        SizeClassStats stats = central.getStats(index);
+        emptyBytes += stats.spans * stats.spanPages * PAGE;
+    }
+    assert(emptyBytes <= CentralCache::MAX_EMPTY_BYTES);
+
+    std::cout << "Empty span cache test passed!" << std::endl;
+}
+
+// 每个大小类的span页数：尾部浪费小，同时每个span仍能切出足够多的内存块
+// 新span惰性切分：只有取出的内存块被写入链表指针，其余部分不被访问
+void testLazyCarve() {
+    std::cout << "Running lazy carve test..." << std::endl;
+
+    // 选一个前面的测试没有用过的大小类，每个span切出 32KB / 776 = 42 块
+    constexpr size_t BLOCK_SIZE = 776;
+    constexpr size_t INDEX = BLOCK_SIZE / ALIGNMENT - 1;
+    CentralCache& central = CentralCache::getInstance();
+
+    char* first = static_cast<char*>(central.fetchRange(INDEX, 1));
+    SpanInfo* span = PageMap::get(first);
+    assert(span->carved == 1 && span->freeCount == span->totalBlocks - 1);
+
+    // 继续按地址顺序切出
+    char* next = static_cast<char*>(central.fetchRange(INDEX, 2));
+    assert(next == first + BLOCK_SIZE && *reinterpret_cast<char**>(next) == next + BLOCK_SIZE);
+    assert(span->carved == 3);
+
+    // 全部归还后span完全空闲，下次重新从头切分
+    char* last = *reinterpret_cast<char**>(next);
+    *reinterpret_cast<void**>(first) = next;
+    *reinterpret_cast<void**>(last) = nullptr;
+    central.returnRange(first, 3, INDEX);
+    assert(span->freeCount == span->totalBlocks && span->carved == 0);
+
+    std::cout << "Lazy carve test passed!" << std::endl;
+}
+
+void testSpanSizing() {
+    std::cout << "Running span sizing test..." << std::endl;
+
+    constexpr size_t MIN_BYTES = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+    for(size_t index = 0; index < FREE_LIST_SIZE; ++index) {
+        size_t size = (index + 1) * ALIGNMENT;
+        size_t pages = CentralCache::classSpanPages(index);
+        size_t blocks = CentralCache::classSpanBlocks(index);
+        assert(blocks >= 1 && blocks * size <= pages * PageCache::PAGE_SIZE);
+        if(size <= MIN_BYTES) {
+            // 不少于固定 8 页时的块数
+            assert(pages >= CentralCache::SPAN_PAGES && pages <= CentralCache::MAX_SPAN_PAGES);
+            assert(blocks >= MIN_BYTES / size);
+        } else {
+            assert(blocks == 1 && pages == (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE);
+        }
+        // 独占span的内存块可以用满整个span
+        if(blocks == 1) {
+            assert(MemoryPool::usableSize(size) == pages * PageCache::PAGE_SIZE);
+        }
+    }
+
+    // 12KB 和 20KB 固定 8 页时分别浪费 8KB 和 12KB，现在没有尾部浪费
+    for(size_t size : {size_t(12 * 1024), size_t(20 * 1024)}) {
+        SizeClassStats before = MemoryPool::sizeClassStats(size);
+        assert(before.tailWaste == 0);
+        std::vector<void*> ptrs;
+        for(size_t i = 0; i < 3 * before.blocksPerSpan; ++i) {
+            void* p = MemoryPool::allocate(size);
+            memset(p, 0x3c, size);
+            SpanInfo* span = PageMap::get(p);
+            assert(span->numPages == before.spanPages && span->totalBlocks == before.blocksPerSpan);
+            ptrs.push_back(p);
+        }
+        SizeClassStats after = MemoryPool::sizeClassStats(size);
+        assert(after.spans > before.spans && after.tailWaste == 0);
+        for(void* p : ptrs) {
+            MemoryPool::deallocate(p, size);
+        }
+    }
+    assert(MemoryPool::sizeClassStats(MAX_BYTES + 1).spans == 0);
+
+    std::cout << "Span sizing test passed!" << std::endl;
+}
+
+void testMediumObjects() {
+    std::cout << "Running medium objects test..." << std::endl;
+
+    // 超过 MEDIUM_BYTES 的请求按页取整，页数相同的大小共用一个大小类
+    constexpr size_t PAGE = PageCache::PAGE_SIZE;
+    assert(SizeClass::roundUp(MEDIUM_BYTES + 1) == MEDIUM_BYTES + PAGE);
+    assert(SizeClass::getIndex(199 * 1024) == SizeClass::getIndex(200 * 1024));
+    assert(SizeClass::getIndex(200 * 1024) != SizeClass::getIndex(200 * 1024 + 1));
+    assert(MemoryPool::usableSize(MEDIUM_BYTES + 1) == MEDIUM_BYTES + PAGE);
+
+    // 释放的span原样留在线程缓存中，页数相同的下一次请求直接复用，不需要重新切分
+    void* p1 = MemoryPool::allocate(200 * 1024);
+    memset(p1, 0x5a, 200 * 1024);
+    MemoryPool::deallocate(p1, 200 * 1024);
+    void* p2 = MemoryPool::allocate(199 * 1024);
+    assert(p2 == p1);
+    SpanInfo* span = PageMap::get(p2);
+    assert(span && span->numPages == 200 * 1024 / PAGE && span->totalBlocks == 1);
+    MemoryPool::deallocate(p2, 199 * 1024);
+
+    // 独占span的内存块原地扩大或缩小时，span的页数、大小类和 PageMap 登记随之更新
+    // 新切分的span后面通常是预留区域中未使用的页，可以原地扩大
+    char* grown = static_cast<char*>(MemoryPool::allocate(100 * 1024));
+    memset(grown, 0x3c, 100 * 1024);
+    char* moved = static_cast<char*>(MemoryPool::reallocate(grown, 100 * 1024, 200 * 1024));
+    if(moved == grown) {
+        span = PageMap::get(moved);
+        assert(span->numPages == 200 * 1024 / PAGE && span->index == SizeClass::getIndex(200 * 1024));
+        assert(PageMap::get(moved + 200 * 1024 - 1) == span);
+    }
+    assert(moved[0] == 0x3c && moved[100 * 1024 - 1] == 0x3c);
+    // 缩小总是原地完成，尾部的页交回页缓存
+    char* shrunk = static_cast<char*>(MemoryPool::reallocate(moved, 200 * 1024, 72 * 1024));
+    assert(shrunk == moved);
+    span = PageMap::get(shrunk);
+    assert(span->numPages == 72 * 1024 / PAGE && span->index == SizeClass::getIndex(72 * 1024));
+    assert(PageMap::get(shrunk + 72 * 1024) != span);
+    assert(shrunk[0] == 0x3c && shrunk[72 * 1024 - 1] == 0x3c);
+    MemoryPool::deallocate(shrunk, 72 * 1024);
+
+    // 大量中等对象反复申请释放，内容互不干扰
+    std::vector<std::pair<void*, size_t>> ptrs;
+    for(size_t i = 0; i < 64; ++i) {
+        size_t size = MEDIUM_BYTES + 1 + i * 3000;
+        void* p = MemoryPool::allocate(size);
+        memset(p, static_cast<int>(i), size);
+        ptrs.emplace_back(p, size);
+    }
+    for(size_t i = 0; i < ptrs.size(); ++i) {
+        auto* bytes = static_cast<unsigned char*>(ptrs[i].first);
+        assert(bytes[0] == i && bytes[ptrs[i].second - 1] == i);
+        MemoryPool::deallocate(ptrs[i].first, ptrs[i].second);
+    }
+
+    std::cout << "Medium objects test passed!" << std::endl;
+}
+
+void testLargeObjects() {
+    std::cout << "Running large objects test..." << std::endl;
+
+    constexpr size_t PAGE = PageCache::PAGE_SIZE;
+    constexpr size_t MB = 1024 * 1024;
+    PageCache& pageCache = PageCache::getInstance();
+
+    // 释放的大对象留在页缓存中，再次申请时优先复用仍占用物理内存的span，而不是重新映射
+    void* p1 = MemoryPool::allocate(4 * MB);
+    memset(p1, 0x6b, 4 * MB);
+    MemoryPool::deallocate(p1, 4 * MB);
+    size_t idle = pageCache.idleBytes();
+    assert(idle >= 4 * MB);
+    void* p2 = MemoryPool::allocateZeroed(4 * MB);
+    assert(pageCache.idleBytes() + 4 * MB <= idle);
+    // 复用的span内容不为零，allocateZeroed 负责清零
+    auto* bytes = static_cast<unsigned char*>(p2);
+    assert(std::all_of(bytes, bytes + 4 * MB, [](unsigned char c) { return c == 0; }));
+
+    // 原地扩缩，内容保持不变
+    memset(p2, 0x2d, 4 * MB);
+    void* p3 = MemoryPool::reallocate(p2, 4 * MB, 3 * MB);
+    assert(p3 == p2);
+    p3 = MemoryPool::reallocate(p3, 3 * MB, 6 * MB);
+    bytes = static_cast<unsigned char*>(p3);
+    assert(bytes[0] == 0x2d && bytes[3 * MB - 1] == 0x2d);
+    memset(bytes + 3 * MB, 0x2d, 3 * MB);
+    MemoryPool::deallocate(p3, 6 * MB);
+
+    // 超过 MMAP_THRESHOLD 的对象单独映射，释放后不进入页缓存
+    idle = pageCache.idleBytes();
+    void* huge = MemoryPool::allocate(PageCache::MMAP_THRESHOLD + 1);
+    static_cast<char*>(huge)[PageCache::MMAP_THRESHOLD] = 1;
+    MemoryPool::deallocate(huge, PageCache::MMAP_THRESHOLD + 1);
+    assert(pageCache.idleBytes() == idle);
+
+    // 空闲超过 RELEASE_DELAY 的span在下次释放时交还物理页
+    void* cold = MemoryPool::allocate(4 * MB);
+    void* hot = MemoryPool::allocate(MB);
+    memset(cold, 0x11, 4 * MB);
+    memset(hot, 0x22, MB);
+    MemoryPool::deallocate(cold, 4 * MB);
+    std::this_thread::sleep_for(PageCache::RELEASE_DELAY + std::chrono::milliseconds(50));
+    MemoryPool::deallocate(hot, MB);
+    std::vector<unsigned char> residency(4 * MB / PAGE);
+    assert(mincore(cold, 4 * MB, residency.data()) == 0);
+    assert(std::none_of(residency.begin(), residency.end(), [](unsigned char r) { return r & 1; }));
+    assert(pageCache.idleBytes() <= PageCache::MAX_IDLE_BYTES);
+
+    // 物理页已交还的span再次分配时全为零，不需要清零
+    void* again = MemoryPool::allocateZeroed(4 * MB);
+    bytes = static_cast<unsigned char*>(again);
+    assert(bytes[0] == 0 && bytes[4 * MB - 1] == 0);
+    MemoryPool::deallocate(again, 4 * MB);
+
+    // 之后没有释放时，下一次从页缓存分配也会交还空闲超过 RELEASE_DELAY 的span
+    void* quiet = MemoryPool::allocate(4 * MB);
+    memset(quiet, 0x33, 4 * MB);
+    MemoryPool::deallocate(quiet, 4 * MB);
+    std::this_thread::sleep_for(PageCache::RELEASE_DELAY + std::chrono::milliseconds(50));
+    void* next = MemoryPool::allocate(MB);
+    assert(mincore(quiet, 4 * MB, residency.data()) == 0);
+    assert(std::none_of(residency.begin(), residency.end(), [](unsigned char r) { return r & 1; }));
+    MemoryPool::deallocate(next, MB);
+
+    std::cout << "Large objects test passed!" << std::endl;
+}
+
+void testPageRegions() {
+    std::cout << "Running page regions test..." << std::endl;
+
+    constexpr size_t SPAN_BYTES = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+    PageCache& pageCache = PageCache::getInstance();
+
+    // 先用完已有的空闲页，直到页缓存预留新的区域
+    size_t regions = pageCache.regionCount();
+    std::vector<void*> spans;
+    while(pageCache.regionCount() == regions) {
+        spans.push_back(pageCache.allocateSpan(CentralCache::SPAN_PAGES));
+        assert(spans.back());
+    }
+    // 之后的span都从新区域中连续切分，不再调用 mmap
+    size_t first = spans.size() - 1;
+    for(size_t i = 0; i < 1000; ++i) {
+        spans.push_back(pageCache.allocateSpan(CentralCache::SPAN_PAGES));
+        assert(static_cast<char*>(spans[spans.size() - 2]) + SPAN_BYTES == spans.back());
+    }
+    assert(pageCache.regionCount() == regions + 1);
+    *static_cast<char*>(spans[first]) = 1;
+    *static_cast<char*>(spans.back()) = 1;
+
+    // 从高地址向低地址释放，连续切分的span依次与后面已释放的span合并
+    std::sort(spans.begin(), spans.end());
+    for(size_t i = spans.size(); i-- > 0;) {
+        pageCache.deallocateSpan(spans[i], CentralCache::SPAN_PAGES);
+    }
+
+    std::cout << "Page regions test passed!" << std::endl;
+}
+
+void testHugePages() {
+    std::cout << "Running huge pages test..." << std::endl;
+
+    constexpr size_t PAGE = PageCache::PAGE_SIZE;
+    constexpr size_t HUGE_PAGE = PageCache::HUGE_PAGE_SIZE;
+    constexpr size_t SPAN_BYTES = CentralCache::SPAN_PAGES * PAGE;
+    PageCache& pageCache = PageCache::getInstance();
+    MemoryPool::setHugePages(true);
+
+    // 用完已有的空闲页后，新预留的区域按大页对齐
+    size_t regions = pageCache.regionCount();
+    std::vector<void*> spans;
+    while(pageCache.regionCount() == regions) {
+        spans.push_back(pageCache.allocateSpan(CentralCache::SPAN_PAGES));
+    }
+    char* first = static_cast<char*>(spans.back());
+    assert(reinterpret_cast<uintptr_t>(first) % HUGE_PAGE == 0);
+    // 区域中只剩下一个候选，下一个span紧挨着第一个
+    char* second = static_cast<char*>(pageCache.allocateSpan(CentralCache::SPAN_PAGES));
+    assert(second == first + SPAN_BYTES);
+
+    // 不小于一个大页的大对象按大页对齐
+    constexpr size_t LARGE = 2 * HUGE_PAGE + 64 * 1024;
+    char* large = static_cast<char*>(MemoryPool::allocate(LARGE));
+    assert(reinterpret_cast<uintptr_t>(large) % HUGE_PAGE == 0);
+
+    memset(first, 0x3e, SPAN_BYTES);
+    memset(large, 0x3e, LARGE);
+    pageCache.deallocateSpan(first, CentralCache::SPAN_PAGES);
+    MemoryPool::deallocate(large, LARGE);
+    std::this_thread::sleep_for(PageCache::RELEASE_DELAY + std::chrono::milliseconds(50));
+    pageCache.deallocateSpan(second, CentralCache::SPAN_PAGES);
+
+    // 大对象中完整的大页已交还；只占大页一小部分的span保留，不拆散所在的大页
+    std::vector<unsigned char> residency(2 * HUGE_PAGE / PAGE);
+    assert(mincore(large, 2 * HUGE_PAGE, residency.data()) == 0);
+    assert(std::none_of(residency.begin(), residency.end(), [](unsigned char r) { return r & 1; }));
+    residency.resize(SPAN_BYTES / PAGE);
+    assert(mincore(first, SPAN_BYTES, residency.data()) == 0);
+    assert(std::all_of(residency.begin(), residency.end(), [](unsigned char r) { return r & 1; }));
+
+    for(size_t i = 0; i + 1 < spans.size(); ++i) {
+        pageCache.deallocateSpan(spans[i], CentralCache::SPAN_PAGES);
+    }
+    MemoryPool::setHugePages(false);
+
+    std::cout << "Huge pages test passed!" << std::endl;
+}
+
+// 按 NUMA 节点分区；单节点机器上用 make numa_test 模拟两个节点运行
+void testNuma() {
+    std::cout << "Running NUMA test..." << std::endl;
+
+    size_t nodes = MemoryPool::numaNodeCount();
+    size_t current = MemoryPool::currentNumaNode();
+    assert(nodes >= 1 && current < nodes);
+
+    // 不存在的节点退化为普通分配
+    void* p = MemoryPool::allocateOnNode(64, Numa::MAX_NODES);
+    assert(p && PageMap::get(p)->node == current);
+    MemoryPool::deallocate(p, 64);
+
+    // 本节点分配的页首次访问后位于本节点（无法查询时为 -1）
+    constexpr size_t LARGE = 1024 * 1024;
+    char* local = static_cast<char*>(MemoryPool::allocateOnNode(LARGE, current));
+    memset(local, 0x5a, LARGE);
+    int actual = Numa::pageNode(local);
+    assert(actual == -1 || static_cast<size_t>(actual) == current);
+    MemoryPool::deallocate(local, LARGE);
+
+    constexpr size_t SIZE = 200;
+    constexpr size_t COUNT = 100;
+    for(size_t node = 0; node < nodes; ++node) {
+        std::vector<void*> blocks;
+        for(size_t i = 0; i < COUNT; ++i) {
+            void* block = MemoryPool::allocateOnNode(SIZE, node);
+            assert(block && PageMap::get(block)->node == node);
+            memset(block, 0x5a, SIZE);
+            blocks.push_back(block);
+        }
+        char* large = static_cast<char*>(MemoryPool::allocateOnNode(LARGE, node));
+        assert(large);
+        memset(large, 0x5a, LARGE);
+
+        // 一半由其他线程释放，释放后都回到所属节点，不留在释放线程的自由链表中
+        std::thread other([&] {
+            for(size_t i = 0; i < COUNT / 2; ++i) {
+                MemoryPool::deallocate(blocks[i], SIZE);
+            }
+        });
+        other.join();
+        // 另一半批量释放，同样逐个按所属节点归还
+        MemoryPool::deallocateBatch(blocks.data() + COUNT / 2, COUNT - COUNT / 2, SIZE);
+        for(size_t i = 0; i < COUNT; ++i) {
+            blocks[i] = MemoryPool::allocate(SIZE);
+            assert(PageMap::get(blocks[i])->node == current);
+        }
+        for(void* block : blocks) {
+            MemoryPool::deallocate(block, SIZE);
+        }
+
+        // 大对象由当前节点的实例释放，转交所属节点的页缓存
+        PageCache::getInstance(current).deallocateLarge(large, LARGE);
+        assert(PageCache::getInstance(node).idleBytes() >= LARGE);
+    }
+
+    std::cout << "NUMA test passed!" << std::endl;
+}
+
+// 接近 SIZE_MAX 的请求必须失败，不能在计算头部和对齐后回绕成小的分配
+// 在 preload_test 中运行时检查的是 LD_PRELOAD 替换后的 malloc 系列函数
+void testOversizedRequests() {
+    std::cout << "Running oversized requests test..." << std::endl;
+
+    // volatile 防止编译器按已知大小直接折叠这些调用
+    volatile size_t huge = SIZE_MAX - 8207;
+    assert(malloc(huge) == nullptr);
+    assert(calloc(1, huge) == nullptr);
+    assert(aligned_alloc(16384, huge) == nullptr);
+    void* ptr = nullptr;
+    assert(posix_memalign(&ptr, 16384, huge) != 0);
+
+    void* small = malloc(16);
+    assert(small != nullptr);
+    assert(realloc(small, huge) == nullptr);
+    free(small);
+
+    // 各种对齐下的边界附近大小
+    for(size_t alignment = 16; alignment <= (1 << 20); alignment <<= 1) {
+        for(size_t slack = 0; slack < 3 * alignment; slack += alignment / 2) {
+            huge = SIZE_MAX - slack;
+            assert(aligned_alloc(alignment, huge & ~(alignment - 1)) == nullptr);
+        }
+    }
+
+    std::cout << "Oversized requests test passed!" << std::endl;
+}
+
+// realloc 缩小到原大小一半以下时要真正释放多余的空间，数据保持不变
+// 在 preload_test 中运行时检查的是 LD_PRELOAD 替换后的 realloc
+void testReallocShrink() {
+    std::cout << "Running realloc shrink test..." << std::endl;
+
+    const size_t MB = 1024 * 1024;
+    char* p = static_cast<char*>(malloc(4 * MB));
+    assert(p != nullptr);
+    for(size_t i = 0; i < 64 * 1024; ++i) {
+        p[i] = static_cast<char>(i % 251);
+    }
+    p = static_cast<char*>(realloc(p, 64 * 1024));
+    assert(p != nullptr);
+    assert(malloc_usable_size(p) < 2 * MB);
+    for(size_t i = 0; i < 64 * 1024; ++i) {
+        assert(p[i] == static_cast<char>(i % 251));
+    }
+
+    // 缩小到小内存块的大小
+    p = static_cast<char*>(realloc(p, 100));
+    assert(p != nullptr);
+    assert(malloc_usable_size(p) < 64 * 1024);
+    for(size_t i = 0; i < 100; ++i) {
+        assert(p[i] == static_cast<char>(i % 251));
+    }
+
+    free(p);
+
+    std::cout << "Realloc shrink test passed!" << std::endl;
+}
+
+// 其他线程正在分配和释放时 fork，子进程中的分配不能因为 fork 时被持有的锁而死锁
+// 在 preload_test 中运行时检查的是 LD_PRELOAD 注册的 fork 处理函数
+void testFork() {
+    std::cout << "Running fork test..." << std::endl;
+
+#ifdef __SANITIZE_ADDRESS__
+    // ASan 自带的分配器在其他线程分配时 fork 并不安全，子进程可能卡在它的锁上
+    std::cout << "Fork test skipped under AddressSanitizer" << std::endl;
+    return;
+#endif
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < 4; ++t) {
+        workers.emplace_back([&stop, t]() {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<size_t> dist(1, 256 * 1024);
+            std::vector<void*> ptrs;
+            while(!stop.load(std::memory_order_relaxed)) {
+                ptrs.push_back(malloc(dist(gen)));
+                if(ptrs.size() > 64) {
+                    for(void* ptr : ptrs) {
+                        free(ptr);
+                    }
+                    ptrs.clear();
+                }
+            }
+            for(void* ptr : ptrs) {
+                free(ptr);
+            }
+        });
+    }
+
+    for(int i = 0; i < 50; ++i) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if(pid == 0) {
+            // 子进程只剩当前线程，覆盖小内存块、中等内存块和大内存块
+            for(size_t size = 8; size <= 4 * 1024 * 1024; size *= 2) {
+                void* ptr = malloc(size);
+                if(!ptr) {
+                    _exit(1);
+                }
+                memset(ptr, 0x5a, size);
+                free(ptr);
+            }
+            _exit(0);
+        }
+        int status = 0;
+        assert(waitpid(pid, &status, 0) == pid);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    stop = true;
+    for(auto& worker : workers) {
+        worker.join();
+    }
+
+    std::cout << "Fork test passed!" << std::endl;
+}
+
 int main() {
     try {
         std::cout << "Starting memory pool tests..." << std::endl;
         testBasicAllocation();
         testMemoryWriting();
         testMultiThreading();
+        testPoolAllocator();
+        testPmrResource();
+        testReallocate();
+        testAllocateZeroed();
+        testAllocateAligned();
+        testAllocateAtLeast();
+        testBatch();
+        testReserve();
+        testArena();
+        testHeap();
+        testRemoteFree();
+        testSpanLocal();
+        testFullestSpan();
+        testEmptySpanCache();
+        testLazyCarve();
+        testSpanSizing();
+        testMediumObjects();
+        testLargeObjects();
+        testPageRegions();
+        testHugePages();
+        testNuma();
+        testOversizedRequests();
+        testReallocShrink();
+        testFork();
 
         std::cout << "All tests passed successfully!" << std::endl;
         return 0;
@@ -0,0 +1,141 @@
+#pragma once
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MemoryPoolv2 {
+// 单调增长的内存区：直接从 PageCache 申请span作为片段，在片段内顺序切分
+// 单个对象不单独释放，通过 rewind 回退到之前的标记或 reset 整体清空，
+// 析构时逐个把span归还 PageCache，开销只与span数量有关
+// 不是线程安全的，每个请求/线程使用自己的 Arena
+// 同时是一个 std::pmr::memory_resource，可以直接作为 pmr 容器的资源
+class Arena : public std::pmr::memory_resource {
+public:
+    // 标记当前分配位置，rewind 时释放标记之后分配的所有内存
+    struct Marker {
+        void* chunk;
+        char* cur;
+    };
+
+    explicit Arena(size_t initialSize = 64 * 1024);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 对齐必须是 2 的幂
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(cur_) + alignment - 1) & ~(alignment - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(end_);
+        // 写成 bytes > end - aligned，避免 bytes 很大时 aligned + bytes 溢出
+        if(!cur_ || aligned > end || bytes > end - aligned) {
+            return allocateSlow(bytes, alignment);
+        }
+        cur_ = reinterpret_cast<char*>(aligned + bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // 在内存区中构造对象，对象的析构函数不会被调用
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    Marker mark() const noexcept {
+        return {chunks_, cur_};
+    }
+
+    // 回退到标记处，标记之后申请的片段归还 PageCache
+    void rewind(Marker marker) noexcept;
+
+    // 清空内存区，只保留最近的一个片段供后续使用
+    void reset() noexcept;
+
+    // 归还所有片段
+    void release() noexcept;
+
+    // 所有片段的总字节数
+    size_t capacity() const noexcept { return capacity_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // 单个对象不回收，统一在 rewind、reset 或析构时归还
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    // 片段头部，位于每个span的起始位置
+    struct Chunk {
+        Chunk* prev;
+        size_t numPages;
+    };
+
+    void* allocateSlow(size_t bytes, size_t alignment);
+    void freeChunk(Chunk* chunk) noexcept;
+
+private:
+    // 最近申请的片段，通过 prev 串起所有片段
+    Chunk* chunks_;
+    char* cur_;
+    char* end_;
+    // 下一个片段的页数，按 2 倍增长
+    size_t nextChunkPages_;
+    size_t initialChunkPages_;
+    size_t capacity_;
+};
+
+// 从 Arena 分配的标准库分配器，deallocate 不做任何事
+// 用法同 PoolAllocator，但带有状态（指向的 Arena），不同 Arena 的分配器不相等
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(Arena& arena) noexcept
+        : arena_(&arena)
+    {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+        : arena_(other.arena())
+    {}
+
+    T* allocate(size_t n) {
+        if(n > size_t(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    Arena* arena() const noexcept { return arena_; }
+
+private:
+    Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.arena() != b.arena();
+}
+} // namespace MemoryPoolv2
@@ -1,5 +1,7 @@
 #pragma once
 #include "Common.h"
+#include "PageMap.h"
+#include "Numa.h"
 #include <mutex>
 #include <unordered_map>
 #include <array>
@@ -34,35 +36,139 @@ namespace MemoryPoolv2 {
 // 中心缓存的作用 是管理多个线程缓存间的内存调度，减少线程间的竞争。
 class CentralCache {
 public:
-    // 中心缓存使用单例模式，保证只有一个实例
+    // 每次从PageCache获取span的最小页数（以页为单位）
+    // 超过 SPAN_PAGES 页的大小类，每个内存块单独占用一个span
+    static const size_t SPAN_PAGES = 8;
+    // 不超过 SPAN_PAGES 页的大小类，为减少span尾部浪费最多使用的页数
+    static const size_t MAX_SPAN_PAGES = 32;
+
+    // 每个大小类的span按已分配比例分成的桶数
+    static const size_t OCCUPANCY_BUCKETS = 8;
+
+    // 每个大小类最多缓存的完全空闲span的总字节数（至少缓存一个span），超出时最早空闲的归还页缓存
+    static const size_t EMPTY_SPAN_BYTES = 1024 * 1024;
+    // 完全空闲的span在中心缓存中停留超过该时间仍未被使用时归还页缓存
+    static constexpr std::chrono::milliseconds EMPTY_SPAN_DELAY{1000};
+    // 每个节点所有大小类缓存的完全空闲span的总字节数上限：
+    // 不再使用的大小类不会触发本类的检查，超出时由归还内存块的线程跨大小类清理
+    static const size_t MAX_EMPTY_BYTES = 16 * 1024 * 1024;
+
+    // 每个 NUMA 节点一个中心缓存，从本节点的页缓存切分span
+    // 不带参数时返回当前线程所在节点的实例；归还的内存块和span按所属节点转交对应的实例
     static CentralCache& getInstance() {
-        static CentralCache instance;
-        return instance;
+        return getInstance(Numa::currentNode());
+    }
+
+    // node 须小于 Numa::nodeCount()，实例在第一次使用时创建
+    static CentralCache& getInstance(size_t node) {
+        CentralCache* instance = instances_[node].load(std::memory_order_acquire);
+        return instance ? *instance : createInstance(node);
     }
 
     // 从中心缓存对应索引的自由链表中批量取出内存块给线程缓存。
     // 如果中心缓存不足，则调用更底层(PageCache)的接口获取更多内存。
-    void* fetchRange(size_t index, size_t batchNum);
+    // zeroed 非空时返回取出的内存块是否来自全零的新span，
+    // 此时除了用作链表指针的第一个字以外，内存块内容全为零
+    // 需要切分新span时，span的所有者记为 owner
+    void* fetchRange(size_t index, size_t batchNum, bool* zeroed = nullptr, RemoteFreeQueue* owner = nullptr);
+
+    // 线程缓存批量归还内存块给中心缓存，每个内存块回到所在span的空闲链表。
+    // count 为以 start 开头的链表中内存块的数量
+    void returnRange(void* start, size_t count, size_t index);
+
+    // span本地模式：取出一个有空闲内存块的span交给线程独占分配，没有时切分新span
+    // span中的空闲块以链表形式通过 blocks 返回，count 为链表长度，zeroed 含义同 fetchRange
+    // 持有期间归还到该span的内存块留在span中，releaseSpan 后重新参与分配
+    SpanInfo* acquireSpan(size_t index, void** blocks, size_t* count, bool* zeroed, RemoteFreeQueue* owner);
+    void releaseSpan(SpanInfo* span);
+
+    // 把独占span的内存块 ptr（已分配出去）原地调整为大小类 index：扩大时向后合并相邻的空闲页，
+    // 缩小时把尾部的页交回页缓存；span的页数、大小类和 PageMap 登记随之更新
+    // ptr 不是独占span的内存块、span被线程持有或无法扩大时返回false
+    bool resizeBlock(void* ptr, size_t index);
+
+    // 大小类 index 每个span的页数和切出的内存块数
+    // 页数按大小类预先计算：在 SPAN_PAGES 到 MAX_SPAN_PAGES 页之间选尾部浪费足够小的最少页数
+    static size_t classSpanPages(size_t index);
+    static size_t classSpanBlocks(size_t index);
+
+    // 大小类 index 在本节点的span使用情况
+    SizeClassStats getStats(size_t index);
+
+    // fork 前取得所有已创建实例的全部大小类锁，fork 后在父子进程中释放
+    // 大小类锁在页缓存的锁之前获取，需先于 PageCache::lockAll 调用
+    static void lockAll();
+    static void unlockAll();
+
+    // 跨大小类清理空闲span：缓存了空闲span的大小类中，空闲超过 EMPTY_SPAN_DELAY 的归还页缓存，
+    // 总量仍超过 MAX_EMPTY_BYTES 时归还预留之外的全部空闲span
+    // 跳过正被其他线程使用的大小类；会获取大小类的锁，不能在持有页缓存的锁时调用
+    void trimEmptyClasses();
 
-    // 线程缓存批量归还内存块给中心缓存。
-    void returnRange(void* start, size_t size, size_t index);
+    // 预先切分span，使中心缓存对应索引的自由链表中至少有 count 个内存块
+    // prefault 为 true 时逐页写入，提前触发缺页，避免第一次使用时才分配物理页
+    // 预留的span即使完全空闲也不会归还页缓存
+    void reserve(size_t index, size_t count, bool prefault);
 
 private:
     // 初始化成员变量，包括自由链表、锁、自旋标志等
     // 相互是还所有原子指针为nullptr
-    CentralCache(){
-        for(auto& ptr: centralFreeList_) {
-            // std::memory_order_relaxed：表示该操作不需要内存同步，只是执行原子操作来存储 nullptr，并没有特别的顺序要求
-            ptr.store(nullptr, std::memory_order_relaxed);
+    explicit CentralCache(size_t node) : node_(node) {
+        for(auto& buckets : spanLists_) {
+            buckets.fill(nullptr);
         }
+        emptySpans_.fill(nullptr);
+        emptyTail_.fill(nullptr);
+        emptyCount_.fill(0);
+        for(auto& bits : emptyClasses_) {
+            bits.store(0, std::memory_order_relaxed);
+        }
+        reservedSpans_.fill(0);
+        spanCount_.fill(0);
         // 初始化所有锁
         // clear() 方法将 std::atomic_flag 的值设置为 false，表示该锁处于 未占用 状态。
         for(auto& lock: locks_) {
             lock.clear(std::memory_order_relaxed);
         }
     }
-    // 从页缓存获取内存
-    void* fetchFromPageCache(size_t size);
+    // 直接映射并绑定到所在节点，不经过内存池；实例从不析构
+    static CentralCache& createInstance(size_t node);
+
+    // 从本节点的页缓存获取内存
+    void* fetchFromPageCache(size_t size, bool* zeroed);
+
+    // 从页缓存获取新span，登记到 PageMap 并切分成内存块，挂到对应大小类的span链表
+    // 需持有该大小类的锁
+    SpanInfo* carveSpan(size_t index, RemoteFreeQueue* owner, bool* zeroed);
+
+    // 从span中取出 n 个空闲内存块（不超过 freeCount）串成链表返回，last 返回链表尾
+    // 先取空闲链表中的，不够时从未切出的部分按地址顺序切出。需持有该大小类的锁
+    static void* takeBlocks(SpanInfo* span, size_t n, void** last);
+
+    // 把 head..tail 共 n 个内存块放回span的空闲链表，span因此变为完全空闲时返回true
+    // 需持有该大小类的锁
+    bool insertBlocks(SpanInfo* span, void* head, void* tail, size_t n);
+
+    // 把span挂到/摘下对应大小类中与其占用率相符的桶，完全空闲的span挂到空闲span链表，需持有该大小类的锁
+    // 桶由 freeCount 计算，修改 freeCount 前先摘下，修改后再挂回
+    void linkSpan(SpanInfo* span);
+    void unlinkSpan(SpanInfo* span);
+
+    // span所在的桶，已分配的内存块越多桶号越大
+    static size_t occupancyBucket(const SpanInfo* span);
+
+    // 占用率最高的有空闲内存块的span，没有部分使用的span时取最近空闲的span，都没有时返回nullptr
+    // 需持有该大小类的锁
+    SpanInfo* fullestSpan(size_t index);
+
+    // 空闲span超出缓存上限或空闲时间超过 EMPTY_SPAN_DELAY 时，从最早空闲的开始归还页缓存
+    // 在有span刚变为完全空闲时调用，需持有该大小类的锁
+    void trimEmptySpans(size_t index, std::chrono::steady_clock::time_point now);
+    // 从中心缓存取出内存块后调用：该大小类不再有span变为空闲时，空闲太久的span也能归还
+    // 需持有该大小类的锁
+    void trimAgedSpans(size_t index);
+    // 把完全空闲的span从链表和 PageMap 中移除，内存归还页缓存
+    void freeSpan(SpanInfo* span);
 
     // 获取span信息
     // 根据给定的内存块地址快速找到对应的SpanTracker。
@@ -75,17 +181,38 @@ private:
     // void updateSpanFreeCount(SpanTracker* tracker, size_t newFreeBlocks, size_t index);
 
 private:
-    // 中心缓存的自由链表
-    // 存储着从PageCache申请的内存块集合，提供给线程缓存快速批量获取。
-    std::array<std::atomic<void*>, FREE_LIST_SIZE> centralFreeList_;
+    // 每个大小类中有空闲内存块、且没有被线程持有的span，按占用率分桶组成双向链表
+    // 空闲内存块串在各自span内部，分配时相邻的内存块来自同一span；
+    // 总是从最满的span分配，几乎空闲的span不再被取用，有机会全部空闲
+    std::array<std::array<SpanInfo*, OCCUPANCY_BUCKETS>, FREE_LIST_SIZE> spanLists_;
+
+    // 完全空闲、已切分好的span，最近空闲的在头部
+    // 大小类在span边界附近来回波动时，不必每次都向页缓存归还再重新申请切分
+    std::array<SpanInfo*, FREE_LIST_SIZE> emptySpans_;
+    std::array<SpanInfo*, FREE_LIST_SIZE> emptyTail_;
+    std::array<size_t, FREE_LIST_SIZE> emptyCount_;
+    // 有空闲span的大小类的位图和所有空闲span的总字节数，跨大小类清理时据此跳过没有空闲span的大小类
+    // 在持有对应大小类的锁时修改
+    std::array<std::atomic<uint64_t>, (FREE_LIST_SIZE + 63) / 64> emptyClasses_;
+    std::atomic<size_t> emptyBytes_{0};
+    // 同一时间只有一个线程做跨大小类清理
+    std::atomic_flag sweeping_ = ATOMIC_FLAG_INIT;
+    // reserve 预留的span数，空闲span不少于该数量时才归还
+    std::array<size_t, FREE_LIST_SIZE> reservedSpans_;
+    // 每个大小类当前切分出的span数（含线程持有和全部分配出去的span）
+    std::array<size_t, FREE_LIST_SIZE> spanCount_;
 
     // 用于同步的自旋锁
     // std::atomic_flag本质上是最简单、最轻量级的原子类型，它提供了线程安全的原子操作。
     // 当多个线程同时访问同一链表时，用于确保并发安全。
     // 性能远高于传统锁
-    // locks_：这是一个 std::array<std::atomic_flag, FREE_LIST_SIZE> 数组，它用来同步多个线程对 centralFreeList_ 的访问。std::atomic_flag 是一种轻量级的同步机制，当多个线程同时访问同一自由链表时，确保并发安全
+    // locks_：这是一个 std::array<std::atomic_flag, FREE_LIST_SIZE> 数组，它用来同步多个线程对 spanLists_ 及其中span的访问。std::atomic_flag 是一种轻量级的同步机制，当多个线程同时访问同一自由链表时，确保并发安全
     std::array<std::atomic_flag, FREE_LIST_SIZE> locks_;
 
+    // 所属的 NUMA 节点
+    size_t node_;
+    static std::atomic<CentralCache*> instances_[Numa::MAX_NODES];
+
     // 使用数组存储span信息，避免map的开销
     // std::array<SpanTracker, 1024> spanTrackers_;
     // spanCount_记录当前使用了多少个span。
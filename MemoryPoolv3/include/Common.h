@@ -10,6 +10,36 @@ constexpr size_t ALIGNMENT = 8;
 constexpr size_t MAX_BYTES = 256 * 1024;
 // ALIGNMENT等于指针void*的大小
 constexpr size_t FREE_LIST_SIZE = MAX_BYTES / ALIGNMENT; 
+// 超过 32KB 的中等对象每个独占一个span，按页取整后以页数作为大小类，
+// 页数相同的请求共用线程缓存和中心缓存中的同一条span链表
+constexpr size_t MEDIUM_BYTES = 32 * 1024;
+constexpr size_t MEDIUM_ALIGNMENT = 4096;
+
+// allocateAtLeast 的返回值：ptr 指向的内存块实际可用 size 字节
+// 调用方可以使用全部 size 字节，释放时传入申请大小与 size 之间的任意值
+struct AllocationResult {
+    void* ptr;
+    size_t size;
+};
+
+// 预先准备 count 个 size 字节的内存块，用于 MemoryPool::reserve 和 warmUpThread
+struct ReserveRequest {
+    size_t size;
+    size_t count;
+};
+
+// 一个大小类的span使用情况，由 MemoryPool::sizeClassStats 返回
+struct SizeClassStats {
+    // 内存块大小
+    size_t blockSize;
+    // 每个span的页数和切出的内存块数
+    size_t spanPages;
+    size_t blocksPerSpan;
+    // 中心缓存当前管理的span数
+    size_t spans;
+    // 这些span尾部切不出一个内存块的字节数之和
+    size_t tailWaste;
+};
 
 // 内存块头部信息
 struct BlockHeader {
@@ -33,6 +63,10 @@ public:
         // 22的二进制: 00010110
         // ~(8-1) = ~(7) = 11111000
         // 00010110 & 11111000 = 00010000，结果是16，刚好是8的整数倍且大于等于15。
+        // 中等对象按页取整
+        if(bytes > MEDIUM_BYTES) {
+            return (bytes + MEDIUM_ALIGNMENT - 1) & ~(MEDIUM_ALIGNMENT - 1);
+        }
         return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
     }
     
@@ -50,7 +84,8 @@ public:
 
         // 以此类推，每个大小请求迅速找到对应的空闲链表。
         // 向上取整后-1
-        return (bytes + ALIGNMENT - 1) / ALIGNMENT - 1;
+        // 中等对象先按页取整，只落在页数对应的大小类上
+        return (roundUp(bytes) + ALIGNMENT - 1) / ALIGNMENT - 1;
     }
 };
 } // namespace MemoryPoolv2
\ No newline at end of file
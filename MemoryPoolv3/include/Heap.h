@@ -0,0 +1,56 @@
+#pragma once
+#include "Common.h"
+#include "MetadataAllocator.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace MemoryPoolv2 {
+struct HeapControl;
+
+// 独立的堆：拥有自己的span和自由链表，与全局 MemoryPool 以及其他 Heap 互不共享内存
+// 每个线程为最近使用的几个堆各保留一小段线程缓存（按堆的 id 区分），小对象分配不需要加锁
+// destroy() 一次性把堆的所有span归还 PageCache，不需要逐个释放对象
+// 适合多租户场景：每个租户一个 Heap，租户下线时整体丢弃其内存
+class Heap {
+public:
+    Heap();
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr, size_t size);
+
+    // 释放堆中的所有内存，之前分配的指针全部失效
+    // 调用时不能有其他线程正在使用这个堆；destroy 之后堆可以继续使用
+    void destroy();
+
+    // 堆当前持有的span总字节数
+    size_t capacity() const;
+
+private:
+    // 线程缓存批量从堆中取出/归还内存块
+    friend struct HeapSlice;
+    void* fetchRange(size_t index, size_t batchNum);
+    void returnRange(void* start, void* end, size_t index);
+
+    // 调用时需持有 mutex_
+    void* allocateSpan(size_t numPages);
+    void refill(size_t index);
+
+private:
+    // 每次 destroy 后更换 id，其他线程中旧 id 的缓存随之失效
+    uint64_t id_;
+    // 记录当前 id 的控制块，其他线程通过它检查缓存所属的堆是否存活
+    HeapControl* control_;
+    // 保护 freeList_ 和 spans_
+    mutable std::mutex mutex_;
+    // 各大小类的自由链表，共 FREE_LIST_SIZE 项，首次使用时直接映射，未用到的页不占物理内存
+    void** freeList_;
+    // 堆持有的所有span：起始地址 -> 页数
+    std::map<void*, size_t, std::less<void*>,
+             MetadataAllocator<std::pair<void* const, size_t>>> spans_;
+};
+} // namespace MemoryPoolv2
@@ -1,5 +1,8 @@
 #pragma once
 #include "ThreadCache.h"
+#include "CentralCache.h"
+#include "PageCache.h"
+#include <initializer_list>
 
 namespace MemoryPoolv2 {
 class MemoryPool {
@@ -8,8 +11,104 @@ public:
         return ThreadCache::getInstance()->allocate(size);
     }
 
+    // 在 NUMA 节点 node 上分配，按 deallocate 正常释放，释放后回到该节点
+    // 节点不存在时（包括单节点机器）等同于 allocate
+    static void* allocateOnNode(size_t size, size_t node) {
+        return ThreadCache::getInstance()->allocateOnNode(size, node);
+    }
+
+    // 节点数与当前线程所在的节点，单节点机器上分别为 1 和 0
+    static size_t numaNodeCount() {
+        return Numa::nodeCount();
+    }
+    static size_t currentNumaNode() {
+        return Numa::currentNode();
+    }
+
+    // 类似 C++23 的 allocate_at_least：返回内存块及其实际可用大小，调用方可以用满大小类的余量
+    static AllocationResult allocateAtLeast(size_t size) {
+        return ThreadCache::getInstance()->allocateAtLeast(size);
+    }
+
+    // 申请 size 字节（allocate、allocateAtLeast 或 reallocate 到 size）得到的内存块实际可用的大小
+    static size_t usableSize(size_t size) {
+        return ThreadCache::usableSize(size);
+    }
+
+    // 按 alignment 对齐分配，alignment 必须是 2 的幂，否则返回nullptr
+    static void* allocateAligned(size_t size, size_t alignment) {
+        return ThreadCache::getInstance()->allocateAligned(size, alignment);
+    }
+
+    // 释放 allocateAligned 分配的内存，size 和 alignment 须与分配时相同
+    static void deallocateAligned(void* ptr, size_t size, size_t alignment) {
+        ThreadCache::getInstance()->deallocateAligned(ptr, size, alignment);
+    }
+
+    // 类似 calloc，分配的内存全为零，按 deallocate 正常释放
+    static void* allocateZeroed(size_t size) {
+        return ThreadCache::getInstance()->allocateZeroed(size);
+    }
+
     static void deallocate(void* ptr, size_t size) {
         ThreadCache::getInstance()->deallocate(ptr, size);
     }
+
+    // 批量分配 n 个相同大小的内存块，返回实际分配的数量
+    static size_t allocateBatch(size_t size, size_t n, void** out) {
+        return ThreadCache::getInstance()->allocateBatch(size, n, out);
+    }
+
+    // 批量释放 n 个相同大小的内存块
+    static void deallocateBatch(void** ptrs, size_t n, size_t size) {
+        ThreadCache::getInstance()->deallocateBatch(ptrs, n, size);
+    }
+
+    // 启动时预先切分span放入中心缓存，例如 reserve({{64, 10000}, {256, 2000}})
+    // prefault 为 true 时同时触发缺页，之后第一次分配不再需要 mmap 和缺页处理
+    static void reserve(std::initializer_list<ReserveRequest> requests, bool prefault = true) {
+        for(const ReserveRequest& request : requests) {
+            ThreadCache::reserve(request.size, request.count, prefault);
+        }
+    }
+
+    // 预热当前线程的缓存，每个工作线程开始处理请求前调用一次
+    static void warmUpThread(std::initializer_list<ReserveRequest> requests) {
+        ThreadCache* cache = ThreadCache::getInstance();
+        for(const ReserveRequest& request : requests) {
+            cache->warmUp(request.size, request.count);
+        }
+    }
+
+    // 开启或关闭当前线程的span本地模式，适合一次性构建之后频繁遍历的数据结构
+    static void setSpanLocal(bool enable) {
+        ThreadCache::getInstance()->setSpanLocal(enable);
+    }
+
+    // 开启或关闭大页模式，只影响之后向系统预留的区域，适合在程序启动时调用。
+    // 常驻的大型索引等 TLB 未命中较多的场景可以减少页表遍历
+    static void setHugePages(bool enable) {
+        PageCache::setHugePages(enable);
+    }
+
+    // 申请 size 字节所在大小类的span使用情况（所有节点之和），超过 MAX_BYTES 的大对象不属于大小类，返回全零
+    static SizeClassStats sizeClassStats(size_t size) {
+        if(size > MAX_BYTES) {
+            return SizeClassStats{};
+        }
+        size_t index = SizeClass::getIndex(size);
+        SizeClassStats stats = CentralCache::getInstance(0).getStats(index);
+        for(size_t node = 1; node < Numa::nodeCount(); ++node) {
+            SizeClassStats other = CentralCache::getInstance(node).getStats(index);
+            stats.spans += other.spans;
+            stats.tailWaste += other.tailWaste;
+        }
+        return stats;
+    }
+
+    // 类似 realloc，但需要调用方提供原大小；失败时返回nullptr，原内存不变
+    static void* reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        return ThreadCache::getInstance()->reallocate(ptr, oldSize, newSize);
+    }
 };
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace MemoryPoolv2 {
+// 内部元数据（Span、std::map 节点等）的分配器
+// 直接通过 mmap 申请内存，不经过 malloc/operator new，
+// 因此内存池替换了全局 malloc 时，PageCache 在持锁期间分配元数据也不会重入内存池
+class MetadataArena {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+
+    // fork 前取得元数据分配器的锁，fork 后在父子进程中释放；其他锁的持有者也会申请元数据，最后获取
+    static void lockAll();
+    static void unlockAll();
+};
+
+// 供标准库容器使用的元数据分配器
+template <typename T>
+class MetadataAllocator {
+public:
+    using value_type = T;
+
+    MetadataAllocator() noexcept = default;
+
+    template <typename U>
+    MetadataAllocator(const MetadataAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        void* p = MetadataArena::allocate(n * sizeof(T));
+        if(!p) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        MetadataArena::deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const MetadataAllocator<T>&, const MetadataAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const MetadataAllocator<T>&, const MetadataAllocator<U>&) noexcept {
+    return false;
+}
+} // namespace MemoryPoolv2
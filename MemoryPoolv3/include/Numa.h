@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+namespace MemoryPoolv2 {
+// NUMA 节点查询与内存放置，直接使用系统调用，不依赖 libnuma
+// 内核不支持 NUMA 或只有一个节点时所有操作退化为单节点：节点数为 1，当前节点为 0，绑定不做任何事
+class Numa {
+public:
+    // 支持的最大节点数，节点号不小于它的按节点 0 处理
+    static const size_t MAX_NODES = 64;
+
+    // 节点数：进程允许使用的最大节点号 + 1，页缓存和中心缓存按节点分区
+    // 环境变量 MEMORYPOOL_NUMA_NODES 可以指定节点数，用于在单节点机器上测试多个分区
+    static size_t nodeCount();
+
+    // 当前线程所在的节点，每个线程第一次调用时通过 getcpu 检测
+    static size_t currentNode();
+
+    // 建议内核把 [ptr, ptr + size) 的页优先放在 node 上（mbind MPOL_PREFERRED），首次访问时生效
+    // ptr 须按页对齐；单节点或节点不存在时不做任何事，页按默认策略分配
+    static void bindMemory(void* ptr, size_t size, size_t node);
+
+    // ptr 所在页当前位于哪个节点（move_pages 查询），页尚未分配物理内存或无法查询时返回 -1
+    static int pageNode(const void* ptr);
+};
+} // namespace MemoryPoolv2
@@ -1,5 +1,9 @@
 #pragma once
 #include "Common.h"
+#include "MetadataAllocator.h"
+#include "Numa.h"
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 
@@ -7,26 +11,130 @@ namespace MemoryPoolv2 {
 class PageCache {
 public:
     static const size_t PAGE_SIZE = 4096; // 每页大小为4KB
+    // 透明大页的大小
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    // 页缓存没有合适的空闲span时一次预留一整块地址空间，从中切分span；
+    // 预留的大小从 MIN_REGION_SIZE 开始每次翻倍，最大 MAX_REGION_SIZE
+    static const size_t MIN_REGION_SIZE = 64 * 1024 * 1024;
+    static const size_t MAX_REGION_SIZE = 1024 * 1024 * 1024;
+    // 超过该大小的大对象单独映射，释放时直接解除映射，扩缩使用 mremap
+    static const size_t MMAP_THRESHOLD = 32 * 1024 * 1024;
+    // 空闲但仍占用物理内存的span总量上限，超出时从最早空闲的开始交还系统
+    static const size_t MAX_IDLE_BYTES = 64 * 1024 * 1024;
+    // 空闲span超过这段时间未被重新使用时交还系统（保留地址空间，只释放物理页）
+    static constexpr std::chrono::milliseconds RELEASE_DELAY{1000};
 
-    // 单例模式，确保全局只有一个PageCache实例，统一管理页面缓存
+    // 每个 NUMA 节点一个PageCache实例，各自预留区域并把区域绑定到所在节点
+    // 不带参数时返回当前线程所在节点的实例；释放、扩缩span时按地址转交所属节点的实例，
+    // 因此任何实例都可以用来释放其他节点分配的span
     static PageCache& getInstance() {
-        // 使用 C++11 的 static 特性实现线程安全的单例模式。
-        // 保证内存池内存管理全局唯一实例，避免多个实例的冲突或内存浪费。
-        static PageCache instance;
-        return instance;
+        return getInstance(Numa::currentNode());
+    }
+
+    // node 须小于 Numa::nodeCount()
+    static PageCache& getInstance(size_t node) {
+        // 使用 C++11 的 static 特性实现线程安全的初始化。
+        // 实例有意不析构：替换全局 malloc 时，其他静态对象的析构函数在退出阶段仍可能释放内存
+        alignas(PageCache) static unsigned char storage[Numa::MAX_NODES * sizeof(PageCache)];
+        static PageCache* instances = createInstances(storage);
+        return instances[node];
     }
 
     // 分配指定页数的span
-    void* allocateSpan(size_t numPages);
+    // zeroed 非空时返回该span是否全为零（刚从系统映射、从未分配出去过）
+    void* allocateSpan(size_t numPages, bool* zeroed = nullptr);
+
+    // 分配起始地址按 alignment（页大小的整数倍）对齐的span，用 deallocateSpan 释放
+    void* allocateSpanAligned(size_t numPages, size_t alignment, bool* zeroed = nullptr);
 
-    // 释放span
+    // 释放span，页数以 PageCache 记录的为准（span 可能已被 growSpan 扩大）
     void deallocateSpan(void* ptr, size_t numPages);
 
+    // 尝试把已分配的span原地扩大到numPages页：
+    // 紧随其后的span空闲且足够大时将其并入，成功返回true；span本身已足够大时也返回true
+    bool growSpan(void* ptr, size_t numPages);
+
+    // 超过 MAX_BYTES 的大对象：不超过 MMAP_THRESHOLD 时按页数从空闲span中分配，
+    // 释放后留在按页数索引的空闲链表中供下次复用；更大的直接映射
+    // zeroed 非空时返回内存是否全为零
+    void* allocateLarge(size_t size, bool* zeroed = nullptr);
+    void deallocateLarge(void* ptr, size_t size);
+    // 原地把大对象调整为 newSize，无法原地调整时返回nullptr，原内存保持不变
+    void* reallocateLarge(void* ptr, size_t oldSize, size_t newSize);
+
+    // 把已分配的span缩小到numPages页，多出的页作为空闲span放回
+    void shrinkSpan(void* ptr, size_t numPages);
+
+    // 大页模式：之后预留的区域按 HUGE_PAGE_SIZE 对齐并建议内核使用透明大页；
+    // 分配span时在少量候选中选择地址最低的，使用中的span集中在少数大页中；
+    // 不小于一个大页的大对象按大页对齐；交还物理页时只交还完整的大页，避免把大页拆散
+    // 对所有节点的实例生效
+    static void setHugePages(bool enable);
+    static bool hugePages() {
+        return hugePages_.load(std::memory_order_relaxed);
+    }
+    // 把 [ptr, ptr + size) 中完整的大页同步合并为透明大页（MADV_COLLAPSE），内核不支持时忽略
+    static void collapseHugePages(void* ptr, size_t size);
+
+    // fork 前取得所有节点实例的锁和区域表的锁，fork 后在父子进程中释放
+    // 需在 CentralCache::lockAll 之后、MetadataArena::lockAll 之前调用，与正常路径的加锁顺序一致
+    static void lockAll();
+    static void unlockAll();
+
+    // 空闲但物理页尚未交还系统的字节数
+    size_t idleBytes();
+    // 向系统预留地址空间的次数
+    size_t regionCount();
+
+    // 直接按页映射，可以用 mremap 扩缩
+    static void* systemAllocLarge(size_t size);
+    // alignment 为大于页大小的 2 的幂，返回的映射同样用 systemFreeLarge 释放
+    static void* systemAllocLargeAligned(size_t size, size_t alignment);
+    static void systemFreeLarge(void* ptr, size_t size);
+    // 失败时返回nullptr，原内存保持不变
+    static void* systemReallocLarge(void* ptr, size_t oldSize, size_t newSize);
+    // 交还 [ptr, ptr + size) 所在页的物理内存，保留映射，之后读到的内容全为零
+    static void discardPages(void* ptr, size_t size);
+
 private:
-    PageCache() = default;
+    explicit PageCache(size_t node) : node_(node) {}
+
+    // 在 storage 中构造所有节点的实例
+    static PageCache* createInstances(void* storage);
+
+    // 多节点时按预留区域找到 ptr 所属节点的实例，找不到或只有一个节点时返回自身
+    PageCache& owner(const void* ptr);
+    // 多节点时把新预留的区域绑定到本节点并登记，登记表已满时解除映射并返回nullptr
+    void* registerRegion(void* memory, size_t size);
+
+    // 向系统预留地址空间，预留的页在首次访问时才占用物理内存
+    // hugeAligned 为 true 时起始地址按 HUGE_PAGE_SIZE 对齐并建议内核使用透明大页
+    void* systemAlloc(size_t numPages, bool hugeAligned = false);
 
-    // 向系统申请内存
-    void* systemAlloc(size_t numPages);
+    // Span 结构体本身由元数据分配器分配，不经过 operator new
+    struct Span;
+    // 以页数为键的空闲span链表
+    using FreeSpanMap = std::map<size_t, Span*, std::less<size_t>,
+                                 MetadataAllocator<std::pair<const size_t, Span*>>>;
+    Span* createSpan();
+    void destroySpan(Span* span);
+
+    // 把空闲span插入对应页数的空闲链表，idle 为 false 时内容不为零的span也不进入空闲时间链表
+    void insertFreeSpan(Span* span, bool idle = true);
+    // 把span从空闲链表中摘下，不在空闲链表中（正在使用）时返回false
+    bool removeFreeSpan(Span* span);
+    // 与前后相邻的空闲span合并后插入空闲链表，返回合并后的span
+    Span* mergeFreeSpan(Span* span);
+
+    // 物理页未交还的空闲span按空闲时间串成链表，头部最新
+    void pushIdle(Span* span);
+    void removeIdle(Span* span);
+    // 交还空闲时间超过 RELEASE_DELAY 或超出 MAX_IDLE_BYTES 的span的物理页，在分配和释放span时调用
+    void trimIdleSpans(std::chrono::steady_clock::time_point now);
+    // 大页模式下只交还span中完整的大页，前后不足一个大页的部分留在空闲链表中但不再计入空闲时间链表
+    void releaseHugePages(Span* span);
+    // 大页模式下从 it 开始的少量候选中选出地址最低的空闲span
+    Span* lowestSpan(FreeSpanMap& spans, FreeSpanMap::iterator it);
 private:
     // Span表示一段连续的内存页，用于统一管理
     struct Span {
@@ -39,15 +147,38 @@ private:
 
         // 链表指针
         Span* next;
+
+        // 内容是否已知全为零：系统新映射或物理页已交还的span为true，分配出去再归还后为false
+        // 空闲且不为零的span通常同时位于空闲时间链表中，大页模式下不足一个大页的部分除外
+        bool zeroed;
+
+        // 是否位于空闲时间链表中
+        bool idle;
+        Span* idlePrev;
+        Span* idleNext;
+        std::chrono::steady_clock::time_point freedAt;
     };
 
     // 按页数管理空闲span，不同页数对应不同Span链表
     // 以页数（numPages）为键，存储链表头（Span*）
-    std::map<size_t, Span*> freeSpans_;
+    FreeSpanMap freeSpans_;
+    // 内容全为零（从未使用或物理页已交还）的空闲span单独管理，
+    // 分配时优先使用 freeSpans_ 中仍占用物理内存的span，避免缺页和清零
+    FreeSpanMap zeroedSpans_;
 
     // 页号到span的映射，用于回收
     // 以起始地址（pageAddr）为键，存储对应的 Span 信息。
-    std::map<void*, Span*> spanMap_;
-    std::mutex mutex_; // 保护freeSpans_和spanMap_的互斥锁
+    std::map<void*, Span*, std::less<void*>,
+             MetadataAllocator<std::pair<void* const, Span*>>> spanMap_;
+    Span* idleHead_ = nullptr;
+    Span* idleTail_ = nullptr;
+    size_t idleBytes_ = 0;
+    // 下一次预留的页数
+    size_t nextRegionPages_ = MIN_REGION_SIZE / PAGE_SIZE;
+    size_t regionCount_ = 0;
+    // 所属的 NUMA 节点
+    size_t node_;
+    static std::atomic<bool> hugePages_;
+    std::mutex mutex_; // 保护空闲span、spanMap_和空闲时间链表的互斥锁
 };
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#include "Common.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace MemoryPoolv2 {
+struct RemoteFreeQueue;
+
+// CentralCache 切分出的span的元数据，由 PageMap 按页查找
+struct SpanInfo {
+    // span起始地址和页数
+    void* start;
+    size_t numPages;
+    // 切分的大小类
+    size_t index;
+    // 切分该span的线程的跨线程释放队列，其他线程释放其中的内存块时交给该线程
+    // 为nullptr时（reserve 预先切分的span、独占span的内存块）在释放线程本地回收
+    RemoteFreeQueue* owner;
+    // 切分该span的中心缓存所在的 NUMA 节点，内存块归还到该节点的中心缓存
+    size_t node;
+
+    // 以下字段由 CentralCache 在对应大小类的锁内维护
+    // span内的空闲内存块，线程缓存中的内存块不计入
+    // 空闲内存块包括链表中的和尚未切出的（下标不小于 carved），freeCount 为两者之和
+    void* freeList;
+    size_t freeCount;
+    // span切分出的内存块总数
+    size_t totalBlocks;
+    // 已切出的内存块数：span按地址顺序惰性切分，只有交给线程缓存时才写入链表指针，
+    // 尚未切出的部分不会被访问，也就不会触发缺页
+    size_t carved;
+    // 被某个线程作为当前span持有（span本地模式），此时不在中心缓存的span链表中
+    bool held;
+    // 中心缓存span链表的前后节点
+    SpanInfo* prev;
+    SpanInfo* next;
+    // 最近一次变为完全空闲的时间，超过 CentralCache::EMPTY_SPAN_DELAY 仍空闲时归还页缓存
+    std::chrono::steady_clock::time_point emptySince;
+};
+
+// 页号到 SpanInfo 的两级基数树，覆盖 48 位虚拟地址空间
+// 根数组常量初始化，叶子按需直接映射；未使用的部分不占物理内存
+// 查找无锁，只有登记新span时加锁
+class PageMap {
+public:
+    static constexpr size_t PAGE_SHIFT = 12;
+    static constexpr size_t LEAF_BITS = 18;
+    static constexpr size_t ROOT_BITS = 48 - PAGE_SHIFT - LEAF_BITS;
+
+    static SpanInfo* get(const void* ptr) {
+        uintptr_t page = reinterpret_cast<uintptr_t>(ptr) >> PAGE_SHIFT;
+        if(page >> (ROOT_BITS + LEAF_BITS)) {
+            return nullptr;
+        }
+        Leaf* leaf = root_[page >> LEAF_BITS].load(std::memory_order_acquire);
+        if(!leaf) {
+            return nullptr;
+        }
+        return leaf->spans[page & (LEAF_SIZE - 1)].load(std::memory_order_acquire);
+    }
+
+    // 把span的每一页登记为 info，叶子映射失败时返回false
+    static bool set(void* start, size_t numPages, SpanInfo* info);
+
+    // fork 前取得映射新叶子的锁，fork 后在父子进程中释放
+    static void lockAll();
+    static void unlockAll();
+
+private:
+    static constexpr size_t LEAF_SIZE = size_t(1) << LEAF_BITS;
+    static constexpr size_t ROOT_SIZE = size_t(1) << ROOT_BITS;
+
+    struct Leaf {
+        std::atomic<SpanInfo*> spans[LEAF_SIZE];
+    };
+
+    static std::atomic<Leaf*> root_[ROOT_SIZE];
+};
+} // namespace MemoryPoolv2
@@ -0,0 +1,58 @@
+#pragma once
+#include "MemoryPool.h"
+#include <memory_resource>
+
+namespace MemoryPoolv2 {
+// 基于 MemoryPool 的 std::pmr::memory_resource
+// 使用 std::pmr 容器的代码只需把资源换成 poolResource()，不需要修改容器类型
+class PoolResource : public std::pmr::memory_resource {
+protected:
+    // 对齐要求交给 MemoryPool::allocateAligned 处理
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+// 全局唯一的 PoolResource，用法同 std::pmr::new_delete_resource()
+std::pmr::memory_resource* poolResource() noexcept;
+
+// 单调增长的资源：从 MemoryPool 申请内存片段，在片段内顺序切分，
+// deallocate 不做任何事，release() 或析构时一次性归还所有片段
+// 适合生命周期相同的大量小对象，也可以作为其他 pmr 资源的上游
+class MonotonicPoolResource : public std::pmr::memory_resource {
+public:
+    explicit MonotonicPoolResource(size_t initialSize = 4096);
+    ~MonotonicPoolResource() override;
+
+    MonotonicPoolResource(const MonotonicPoolResource&) = delete;
+    MonotonicPoolResource& operator=(const MonotonicPoolResource&) = delete;
+
+    // 归还所有片段
+    void release();
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    // 片段头部，位于每个片段的起始位置
+    struct Chunk {
+        Chunk* next;
+        // 片段总大小（含头部），归还给 MemoryPool 时使用
+        size_t size;
+    };
+
+    // 申请一个至少能容纳 bytes 字节（按 alignment 对齐）的新片段
+    void allocateChunk(size_t bytes, size_t alignment);
+
+private:
+    Chunk* chunks_;
+    // 当前片段中下一个可用位置和片段末尾
+    char* cur_;
+    char* end_;
+    // 下一个片段的大小，按 2 倍增长，最大为 MAX_BYTES 以保证片段仍由内存池管理
+    size_t nextChunkSize_;
+    size_t initialSize_;
+};
+} // namespace MemoryPoolv2
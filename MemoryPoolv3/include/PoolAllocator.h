@@ -0,0 +1,104 @@
+#pragma once
+#include "MemoryPool.h"
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace MemoryPoolv2 {
+// 对应 C++23 的 std::allocation_result
+template <typename Pointer>
+struct allocation_result {
+    Pointer ptr;
+    std::size_t count;
+};
+
+// 符合标准库 Allocator 要求的分配器，可直接用于 std::map、std::list 等容器
+// 内存来自 MemoryPool，释放时按 n * sizeof(T) 归还到对应大小类
+// alignof(T) 超过 ALIGNMENT 的类型通过 allocateAligned 分配
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    // 分配器无状态，所有实例都可以互相释放对方分配的内存
+    using is_always_equal = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_type n) {
+        // 节点型容器（map、list、unordered_map 的节点）每次只申请一个对象
+        if(n == 1) {
+            return allocateBytes(sizeof(T));
+        }
+        if(n > max_size()) {
+            throw std::bad_array_new_length();
+        }
+        return allocateBytes(n * sizeof(T));
+    }
+
+    // 与 C++23 的 allocate_at_least 相同：返回的 count 不小于 n，
+    // 调用方可以使用全部 count 个对象的空间，并按 count 释放
+    allocation_result<T*> allocate_at_least(size_type n) {
+        if constexpr(alignof(T) > ALIGNMENT) {
+            return {allocate(n), n};
+        } else {
+            if(n > max_size()) {
+                throw std::bad_array_new_length();
+            }
+            AllocationResult result = MemoryPool::allocateAtLeast(n * sizeof(T));
+            if(!result.ptr) {
+                throw std::bad_alloc();
+            }
+            return {static_cast<T*>(result.ptr), result.size / sizeof(T)};
+        }
+    }
+
+    void deallocate(T* p, size_type n) noexcept {
+        if constexpr(alignof(T) > ALIGNMENT) {
+            MemoryPool::deallocateAligned(p, n * sizeof(T), alignof(T));
+        } else {
+            MemoryPool::deallocate(p, n * sizeof(T));
+        }
+    }
+
+    size_type max_size() const noexcept {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+private:
+    static T* allocateBytes(size_type bytes) {
+        void* p;
+        if constexpr(alignof(T) > ALIGNMENT) {
+            p = MemoryPool::allocateAligned(bytes, alignof(T));
+        } else {
+            p = MemoryPool::allocate(bytes);
+        }
+        if(!p) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+    return false;
+}
+} // namespace MemoryPoolv2
@@ -0,0 +1,102 @@
+#pragma once
+#include "MemoryPool.h"
+#include <cstring>
+
+namespace MemoryPoolv2 {
+// 基于 MemoryPool 的可增长字节缓冲区
+// 容量总是取内存块的实际可用大小，追加数据时先用满大小类的余量再扩容；
+// 扩容通过 MemoryPool::reallocate 进行，独占span的块和大对象可以原地扩大或 mremap，避免拷贝
+class PoolBuffer {
+public:
+    PoolBuffer() noexcept
+        : data_(nullptr)
+        , size_(0)
+        , capacity_(0)
+    {}
+
+    explicit PoolBuffer(size_t capacity)
+        : PoolBuffer()
+    {
+        reserve(capacity);
+    }
+
+    ~PoolBuffer() {
+        if(data_) {
+            MemoryPool::deallocate(data_, capacity_);
+        }
+    }
+
+    PoolBuffer(PoolBuffer&& other) noexcept
+        : data_(other.data_)
+        , size_(other.size_)
+        , capacity_(other.capacity_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    PoolBuffer& operator=(PoolBuffer&& other) noexcept {
+        if(this != &other) {
+            if(data_) {
+                MemoryPool::deallocate(data_, capacity_);
+            }
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.capacity_ = 0;
+        }
+        return *this;
+    }
+
+    PoolBuffer(const PoolBuffer&) = delete;
+    PoolBuffer& operator=(const PoolBuffer&) = delete;
+
+    char* data() noexcept { return data_; }
+    const char* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // 确保容量至少为 capacity，失败时抛出 std::bad_alloc
+    void reserve(size_t capacity) {
+        if(capacity > capacity_) {
+            grow(capacity);
+        }
+    }
+
+    // 新增的部分不初始化
+    void resize(size_t size) {
+        reserve(size);
+        size_ = size;
+    }
+
+    void append(const void* bytes, size_t n) {
+        if(n > capacity_ - size_) {
+            grow(size_ + n);
+        }
+        memcpy(data_ + size_, bytes, n);
+        size_ += n;
+    }
+
+    void push_back(char c) {
+        if(size_ == capacity_) {
+            grow(size_ + 1);
+        }
+        data_[size_++] = c;
+    }
+
+    void clear() noexcept { size_ = 0; }
+
+private:
+    // 按 2 倍增长，容量取新内存块的实际可用大小
+    void grow(size_t minCapacity);
+
+private:
+    char* data_;
+    size_t size_;
+    size_t capacity_;
+};
+} // namespace MemoryPoolv2
@@ -1,5 +1,6 @@
 #pragma once
 #include "Common.h"
+#include <atomic>
 
 //           +------------+     allocate
 // 线程A --> | ThreadCache| ---> 用户请求内存
@@ -15,6 +16,22 @@
 
 
 namespace MemoryPoolv2 {
+struct SpanInfo;
+
+// 跨线程释放队列（多生产者单消费者）
+// 其他线程释放本线程切分的span中的内存块时无锁压入 head，
+// 所有者在下一次慢路径上一次性取走整条链，放回本地自由链表
+struct RemoteFreeQueue {
+    std::atomic<void*> head;
+    // 已压入但尚未取走的块数（只会偏大），超过上限后其他线程改为本地回收，
+    // 避免所有者长时间不走慢路径时无限堆积
+    std::atomic<size_t> pending;
+    // 所有者线程退出后为false，其他线程不再压入
+    std::atomic<bool> alive;
+    // 队列回收池中的下一个队列
+    RemoteFreeQueue* nextFree;
+};
+
 // 线程本地缓存
 class ThreadCache {
 public:
@@ -29,10 +46,58 @@ public:
     // 若本地缓存不足，则通过fetchFromCentralCache从中心缓存获取新的内存块。
     void* allocate(size_t size);
 
+    // 从 NUMA 节点 node 的中心缓存或页缓存分配，不经过线程本地缓存
+    // node 不存在（包括单节点机器上的其他节点）或就是当前线程所在节点时等同于 allocate
+    void* allocateOnNode(size_t size, size_t node);
+
+    // 分配至少 size 字节，并返回内存块实际可用的大小
+    AllocationResult allocateAtLeast(size_t size) {
+        return {allocate(size), usableSize(size)};
+    }
+
+    // 申请 size 字节时得到的内存块实际可用的大小
+    static size_t usableSize(size_t size);
+
+    // 按 alignment（2 的幂）对齐分配，需用 deallocateAligned 以相同的 size 和 alignment 释放
+    // 不超过页大小的对齐把大小向上取整到对齐的倍数，利用大小类内存块的天然对齐；
+    // 更大的对齐从 PageCache 分配对齐的span，超过 MMAP_THRESHOLD 时直接按对齐映射
+    void* allocateAligned(size_t size, size_t alignment);
+    void deallocateAligned(void* ptr, size_t size, size_t alignment);
+
+    // 分配内容全为零的内存块
+    // 来自全零新span的内存块只需清掉链表指针，回收再利用的内存块才整体清零
+    void* allocateZeroed(size_t size);
+
     // 将用户释放的内存放回线程本地缓存。
     // 若线程本地缓存超过一定阈值，则将多余内存通过returnToCentralCache归还给中心缓存
     void deallocate(void* ptr, size_t size);
 
+    // 批量分配 n 个 size 字节的内存块写入 out，返回实际分配的数量（内存不足时可能小于 n）
+    size_t allocateBatch(size_t size, size_t n, void** out);
+
+    // 批量释放 n 个 size 字节的内存块
+    void deallocateBatch(void** ptrs, size_t n, size_t size);
+
+    // 预先在当前节点的中心缓存中准备 count 个 size 字节的内存块，同一节点的所有线程共享
+    static void reserve(size_t size, size_t count, bool prefault);
+
+    // 预先向当前线程的自由链表放入 count 个 size 字节的内存块（最多到链表长度阈值）
+    void warmUp(size_t size, size_t count);
+
+    // 调整内存块大小，尽量避免分配新块和拷贝：
+    // 新旧大小属于同一大小类时原地返回；独占span的内存块尝试并入后面空闲的span；
+    // 超过 MAX_BYTES 的大对象原地扩缩span，超过 MMAP_THRESHOLD 的使用 mremap。其余情况分配新块并拷贝
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize);
+
+    // 开启或关闭当前线程的span本地模式：每个大小类只从一个当前span分配，
+    // 用完再换下一个；释放的内存块直接回到所在span。
+    // 连续分配的内存块集中在少数页面中，遍历构建出的数据结构时TLB和缓存未命中更少
+    void setSpanLocal(bool enable);
+
+    // fork 前取得跨线程释放队列回收池的锁，fork 后在父子进程中释放
+    static void lockAll();
+    static void unlockAll();
+
 private:
     ThreadCache() = default;
 
@@ -40,7 +105,8 @@ private:
     // 当线程本地缓存不足以满足请求时调用
     // 作用是从中心缓存（Central Cache）中请求内存，并填充到本地缓存。
     // 中心缓存通常为多线程共享，需要同步访问。
-    void* fetchFromCentralCache(size_t index);
+    // zeroed 含义同 CentralCache::fetchRange
+    void* fetchFromCentralCache(size_t index, bool* zeroed = nullptr);
 
     // 归还内存到中心缓存
     // 将多余的本地缓存归还给中心缓存。
@@ -54,11 +120,54 @@ private:
     // 当超过阈值时，触发归还内存给中心缓存，以避免内存浪费
     bool shouldReturnToCentralCache(size_t index);
 
+    // 本线程的跨线程释放队列，第一次使用时创建并注册线程退出回调
+    RemoteFreeQueue* remoteQueue();
+
+    // 把 ptr 交给所有者回收，同一所有者的内存块先在本地攒成一批再压入其队列
+    // 所有者已退出时返回false
+    bool freeRemote(RemoteFreeQueue* owner, void* ptr);
+
+    // 把攒下的跨线程释放压入所有者队列
+    void flushRemoteFrees();
+
+    // 先压出本线程攒下的跨线程释放，再取走其他线程释放回来的内存块
+    void drainRemoteFrees();
+
+    // 把以nullptr结尾的内存块链按所在span的大小类放回本地自由链表，返回块数
+    // 取回的内存块马上就会被分配，不按阈值归还中心缓存，数量受 MAX_REMOTE_PENDING 限制
+    size_t insertRemoteBlocks(void* block);
+
+    // span本地模式下当前span用完时，换一个有空闲内存块的span
+    void* fetchLocalSpan(size_t index, bool* zeroed);
+
+    // 释放内存块：span本地模式下不属于当前span的内存块直接归还所在span
+    // trim 为 true 时链表超过阈值即归还中心缓存
+    void freeLocal(void* ptr, size_t index, SpanInfo* span, bool trim);
+
+    // 本地自由链表全部归还中心缓存
+    void returnAllToCentralCache();
+
+    // 交还所有当前span并关闭span本地模式
+    void releaseLocalSpans();
+
+    // 线程退出时调用：停止接收跨线程释放，本地缓存全部归还中心缓存
+    void releaseAll();
+    static void onThreadExit(void* cache);
+
 private:
     // 每个线程的自由链表数组
     std::array<void*, FREE_LIST_SIZE> freeList_;
     // 自由链表大小统计   
     std::array<size_t, FREE_LIST_SIZE> freeListSize_;
+    // 跨线程释放队列，未创建时为nullptr
+    RemoteFreeQueue* remote_;
+    // 攒着尚未压入所有者队列的跨线程释放，本线程走慢路径或退出时压出
+    RemoteFreeQueue* pendingOwner_;
+    void* pendingHead_;
+    void* pendingTail_;
+    size_t pendingCount_;
+    // span本地模式下每个大小类的当前span，按需映射；为nullptr表示未开启
+    SpanInfo** localSpans_;
 };
 
 }   // namespace MemoryPoolv2
\ No newline at end of file
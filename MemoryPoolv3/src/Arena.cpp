@@ -0,0 +1,99 @@
+#include "Arena.h"
+#include "PageCache.h"
+#include <algorithm>
+
+namespace MemoryPoolv2 {
+namespace {
+// 片段最多增长到 1MB，更大的请求单独成片
+constexpr size_t MAX_CHUNK_PAGES = 256;
+
+size_t pagesFor(size_t bytes) {
+    return (bytes + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
+}
+} // namespace
+
+Arena::Arena(size_t initialSize)
+    : chunks_(nullptr)
+    , cur_(nullptr)
+    , end_(nullptr)
+    , nextChunkPages_(std::min(std::max(pagesFor(initialSize), size_t(1)), MAX_CHUNK_PAGES))
+    , initialChunkPages_(nextChunkPages_)
+    , capacity_(0)
+{}
+
+Arena::~Arena() {
+    release();
+}
+
+void* Arena::allocateSlow(size_t bytes, size_t alignment) {
+    // 头部之后按 alignment 对齐最多浪费 alignment - 1 字节
+    size_t needed = sizeof(Chunk) + bytes + alignment - 1;
+    if(needed < bytes) {
+        throw std::bad_alloc();
+    }
+    size_t numPages = std::max(nextChunkPages_, pagesFor(needed));
+
+    void* memory = PageCache::getInstance().allocateSpan(numPages);
+    if(!memory) {
+        throw std::bad_alloc();
+    }
+
+    Chunk* chunk = static_cast<Chunk*>(memory);
+    chunk->prev = chunks_;
+    chunk->numPages = numPages;
+    chunks_ = chunk;
+    capacity_ += numPages * PageCache::PAGE_SIZE;
+
+    cur_ = reinterpret_cast<char*>(chunk + 1);
+    end_ = static_cast<char*>(memory) + numPages * PageCache::PAGE_SIZE;
+    nextChunkPages_ = std::min(nextChunkPages_ * 2, MAX_CHUNK_PAGES);
+
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(cur_) + alignment - 1) & ~(alignment - 1);
+    cur_ = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::rewind(Marker marker) noexcept {
+    Chunk* target = static_cast<Chunk*>(marker.chunk);
+    while(chunks_ != target) {
+        Chunk* prev = chunks_->prev;
+        freeChunk(chunks_);
+        chunks_ = prev;
+    }
+
+    if(chunks_) {
+        cur_ = marker.cur;
+        end_ = reinterpret_cast<char*>(chunks_) + chunks_->numPages * PageCache::PAGE_SIZE;
+    } else {
+        cur_ = nullptr;
+        end_ = nullptr;
+        nextChunkPages_ = initialChunkPages_;
+    }
+}
+
+void Arena::reset() noexcept {
+    if(!chunks_) {
+        return;
+    }
+    // 最近的片段通常最大，保留它，其余归还
+    Chunk* keep = chunks_;
+    Chunk* chunk = keep->prev;
+    while(chunk) {
+        Chunk* prev = chunk->prev;
+        freeChunk(chunk);
+        chunk = prev;
+    }
+    keep->prev = nullptr;
+    cur_ = reinterpret_cast<char*>(keep + 1);
+    end_ = reinterpret_cast<char*>(keep) + keep->numPages * PageCache::PAGE_SIZE;
+}
+
+void Arena::release() noexcept {
+    rewind({nullptr, nullptr});
+}
+
+void Arena::freeChunk(Chunk* chunk) noexcept {
+    capacity_ -= chunk->numPages * PageCache::PAGE_SIZE;
+    PageCache::getInstance().deallocateSpan(chunk, chunk->numPages);
+}
+} // namespace MemoryPoolv2
@@ -1,18 +1,166 @@
 #include "CentralCache.h"
 #include "PageCache.h"
+#include "MetadataAllocator.h"
 #include <cassert>
+#include <cstdint>
+#include <algorithm>
 #include <thread>
 #include <chrono>
+#include <new>
+#include <mutex>
 
 namespace MemoryPoolv2 {
 // const std::chrono::milliseconds CentralCache::DELAY_INTERVAL{1000};
 
-// 每次从PageCache获取span大小（以页为单位）
-static const size_t SPAN_PAGES = 8;
+static_assert(MEDIUM_ALIGNMENT == PageCache::PAGE_SIZE && MEDIUM_BYTES == CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE,
+              "medium size classes must match single-block spans");
+
+namespace {
+// 一个span最多切出的内存块数
+constexpr size_t MAX_SPAN_BLOCKS = CentralCache::MAX_SPAN_PAGES * PageCache::PAGE_SIZE / ALIGNMENT;
+
+// 每个大小类的span页数表
+// 不超过 SPAN_PAGES 页的大小类：从 SPAN_PAGES 页开始，取尾部浪费不超过span 1/16 的最少页数，
+// 到 MAX_SPAN_PAGES 页仍找不到时取浪费比例最小的页数。例如 12KB 的大小类用 9 页切出 3 块，
+// 20KB 的用 10 页切出 2 块，固定 8 页时它们分别浪费 8KB 和 12KB
+// 更大的大小类每个内存块独占一个span，按页取整
+struct SpanPagesTable {
+    uint8_t pages[FREE_LIST_SIZE];
+};
+
+constexpr SpanPagesTable makeSpanPagesTable() {
+    constexpr size_t MIN_BYTES = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+    SpanPagesTable table{};
+    for(size_t index = 0; index < FREE_LIST_SIZE; ++index) {
+        size_t size = (index + 1) * ALIGNMENT;
+        if(size > MIN_BYTES) {
+            table.pages[index] = static_cast<uint8_t>((size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE);
+            continue;
+        }
+        size_t best = CentralCache::SPAN_PAGES;
+        // 比较 waste / spanBytes，交叉相乘避免浮点
+        size_t bestWaste = MIN_BYTES % size;
+        size_t bestBytes = MIN_BYTES;
+        for(size_t pages = CentralCache::SPAN_PAGES; pages <= CentralCache::MAX_SPAN_PAGES; ++pages) {
+            size_t bytes = pages * PageCache::PAGE_SIZE;
+            size_t waste = bytes % size;
+            if(waste * 16 <= bytes) {
+                best = pages;
+                break;
+            }
+            if(waste * bestBytes < bestWaste * bytes) {
+                best = pages;
+                bestWaste = waste;
+                bestBytes = bytes;
+            }
+        }
+        table.pages[index] = static_cast<uint8_t>(best);
+    }
+    return table;
+}
+
+constexpr SpanPagesTable SPAN_PAGES_TABLE = makeSpanPagesTable();
+
+// 把span的空闲链表按地址顺序重建，末尾接上 rest，返回新的链表头：
+// 释放顺序是随机的，按原链表分配会在span的各页之间来回跳
+void* sortSpanBlocks(const SpanInfo* span, void* blocks, void* rest) {
+    if(!blocks) {
+        return rest;
+    }
+    if(span->totalBlocks <= 1) {
+        return blocks;
+    }
+    size_t size = (span->index + 1) * ALIGNMENT;
+    char* start = static_cast<char*>(span->start);
+
+    uint64_t bitmap[MAX_SPAN_BLOCKS / 64] = {};
+    for(void* block = blocks; block; block = *reinterpret_cast<void**>(block)) {
+        size_t i = (static_cast<char*>(block) - start) / size;
+        bitmap[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    void* head = nullptr;
+    void** link = &head;
+    for(size_t word = 0; word * 64 < span->totalBlocks; ++word) {
+        for(uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+            void* block = start + (word * 64 + __builtin_ctzll(bits)) * size;
+            *link = block;
+            link = reinterpret_cast<void**>(block);
+        }
+    }
+    *link = rest;
+    return head;
+}
+
+// 把span中下标 [begin, end) 的内存块按地址顺序串成链表，最后一块指向nullptr
+void* linkSpanBlocks(const SpanInfo* span, size_t begin, size_t end, void** last) {
+    size_t size = (span->index + 1) * ALIGNMENT;
+    char* first = static_cast<char*>(span->start) + begin * size;
+    char* block = first;
+    for(size_t i = begin + 1; i < end; ++i) {
+        *reinterpret_cast<void**>(block) = block + size;
+        block += size;
+    }
+    *reinterpret_cast<void**>(block) = nullptr;
+    if(last) {
+        *last = block;
+    }
+    return first;
+}
+} // namespace
+
+std::atomic<CentralCache*> CentralCache::instances_[Numa::MAX_NODES];
+
+CentralCache& CentralCache::createInstance(size_t node) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    CentralCache* instance = instances_[node].load(std::memory_order_relaxed);
+    if(!instance) {
+        void* memory = PageCache::systemAllocLarge(sizeof(CentralCache));
+        if(!memory) {
+            throw std::bad_alloc();
+        }
+        Numa::bindMemory(memory, sizeof(CentralCache), node);
+        instance = new (memory) CentralCache(node);
+        instances_[node].store(instance, std::memory_order_release);
+    }
+    return *instance;
+}
+
+void CentralCache::lockAll() {
+    for(size_t node = 0; node < Numa::MAX_NODES; ++node) {
+        CentralCache* instance = instances_[node].load(std::memory_order_acquire);
+        if(!instance) {
+            continue;
+        }
+        // 清理线程只尝试获取大小类锁，先等它结束，子进程中的清理标记才不会一直被占用
+        while(instance->sweeping_.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        for(auto& lock : instance->locks_) {
+            while(lock.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+void CentralCache::unlockAll() {
+    for(size_t node = 0; node < Numa::MAX_NODES; ++node) {
+        CentralCache* instance = instances_[node].load(std::memory_order_acquire);
+        if(!instance) {
+            continue;
+        }
+        for(auto& lock : instance->locks_) {
+            lock.clear(std::memory_order_release);
+        }
+        instance->sweeping_.clear(std::memory_order_release);
+    }
+}
 
 // 当线程缓存（ThreadCache）不足时，会调用此函数从中心缓存（CentralCache）批量获取内存。
 // 如果中心缓存没有可用内存，则进一步从底层的页缓存（PageCache）获取大块内存并切分为小块。
-void* CentralCache::fetchRange(size_t index, size_t batchNum) {
+void* CentralCache::fetchRange(size_t index, size_t batchNum, bool* zeroed, RemoteFreeQueue* owner) {
     // 索引检查，当索引大于等于FREE_LIST_SIZE时，说明申请内存过大应直接向系统申请
     if(index >= FREE_LIST_SIZE || batchNum == 0) {
         return nullptr; // 索引越界，无法获取内存
@@ -51,79 +199,48 @@ void* CentralCache::fetchRange(size_t index, size_t batchNum) {
 
     void* result = nullptr;
     try {
-        // 尝试从中心缓存获取内存块
-        // 在读取时使用松散的内存顺序（relaxed）来优化性能。
-        // 在写入时使用释放内存顺序（release）来确保内存操作的正确顺序和数据一致性。
-        result = centralFreeList_[index].load(std::memory_order_relaxed);
-
-        if(!result) {
-            // 若中心缓存为空，从底层页缓存（PageCache）获取新的内存
-            // size 就是单个内存块大小
-            size_t size = (index + 1) * ALIGNMENT;
-            result = fetchFromPageCache(size);
-
-            if(!result) {
+        SpanInfo* span = fullestSpan(index);
+        if(!span) {
+            // 若中心缓存为空，从底层页缓存（PageCache）获取新的span切分
+            bool spanZeroed = false;
+            span = carveSpan(index, owner, &spanZeroed);
+            if(!span) {
                 locks_[index].clear(std::memory_order_release);
                 // 若页缓存也无法提供内存，释放锁并返回nullptr表示失败。
                 return nullptr;
             }
-
-            // 将获取的内存块切分成小块
-            // 从更底层的PageCache成功获取到一大块连续内存（一个Span）后。
-            // 现在要做的事情是：
-            // 将这一大块内存切割成多个小块。
-            // 构建链表，存入CentralCache的自由链表中，以便后续分配。
-            // 从切割出的内存块中，取出一个返回给调用者（通常是ThreadCache），其他的存入中心缓存。
-            // 转换为char*类型，便于后续地址运算（字节级偏移）。
-            char* start = static_cast<char*>(result);
-
-            // 8 * 4096 = 32768 (32KB) / size
-            // 计算总块数
-            size_t totalBlocks = (SPAN_PAGES * PageCache::PAGE_SIZE) / size; 
-
-            size_t allocBlocks = std::min(batchNum, totalBlocks); // 实际分配的块数
-            
-            // 构建返回给ThreadCache的内存块链表
-            if(allocBlocks > 1) {
-                // 确保至少有两个块才构建链表
-                // 构建链表
-                for(size_t i = 1; i < allocBlocks; ++i) {
-                    void* current = start + (i - 1) * size;
-                    void* next = start + i * size;
-                    *reinterpret_cast<void**>(current) = next;
-                }
-                *reinterpret_cast<void**>(start + (allocBlocks - 1) * size) = nullptr; // 最后一个块指向nullptr
-            } 
-
-            // 构建保留在CentralCache的链表
-            if(totalBlocks > allocBlocks) {
-                void* remainStart = start + allocBlocks * size;
-                for(size_t i = allocBlocks + 1; i < totalBlocks; ++i) {
-                    void* current = start + (i - 1) * size;
-                    void* next = start + i * size;
-                    *reinterpret_cast<void**>(current) = next;
-                }
-                *reinterpret_cast<void**>(start + (totalBlocks - 1) * size) = nullptr; // 最后一个块指向nullptr
-                centralFreeList_[index].store(remainStart, std::memory_order_release); // 更新中心缓存的自由链表头
+            // 链表中只有这一个新span，下面取出的内存块都来自它
+            if(zeroed) {
+                *zeroed = spanZeroed;
             }
-        } else {
-            // 如果中心缓存有index对应大小的内存块
-            // 从现有链表中获取指定数量的块
-            void* current = result;
-            void* prev = nullptr;
-            size_t count = 0;
-
-            while(current && count < batchNum) {
-                prev = current; // 保留前一个块
-                current = *reinterpret_cast<void**>(current); // 获取下一个块
-                count++;
+        } else if(zeroed) {
+            // 已有span中的内存块可能被使用过，内容未知
+            *zeroed = false;
+        }
+
+        // 从最满的span开始依次取出内存块，拼成一条链返回
+        void* tail = nullptr;
+        size_t count = 0;
+        while(count < batchNum && (span = fullestSpan(index))) {
+            unlinkSpan(span);
+            size_t take = std::min(batchNum - count, span->freeCount);
+            void* last = nullptr;
+            void* first = takeBlocks(span, take, &last);
+
+            if(tail) {
+                *reinterpret_cast<void**>(tail) = first;
+            } else {
+                result = first;
             }
-            // 当前centralFreeList_[index]链表上的内存块大于batchNum时需要用到 
-            if(prev) {
-                *reinterpret_cast<void**>(prev) = nullptr;
+            tail = last;
+            count += take;
+
+            // span中的内存块都已分配出去时不再挂回
+            if(span->freeCount > 0) {
+                linkSpan(span);
             }
-            centralFreeList_[index].store(current, std::memory_order_release); // 更新中心缓存的自由链表头
         }
+        trimAgedSpans(index);
     } catch(...) {
         // 发生异常时确保释放锁
         locks_[index].clear(std::memory_order_release);
@@ -136,12 +253,12 @@ void* CentralCache::fetchRange(size_t index, size_t batchNum) {
 }
 
 // CentralCache::returnRange 函数的作用是将一段内存（或内存块）归还给中央缓存（central cache）以便后续重用
-// 将归还的内存块组织为自由链表并连接到中央缓存相应索引(index)的链表头部。
-// 更新缓存相关计数，并判断是否触发延迟归还机制。
+// 通过 PageMap 找到每个内存块所在的span，放回该span的空闲链表，
+// span由满变为有空闲时重新挂到中心缓存的span链表中。
 // void* start: 这是指向待归还内存块的起始位置的指针。
-// size_t size: 这是待归还内存块的大小。
+// size_t count: 链表中内存块的数量，按数量遍历，不依赖链表末尾的nullptr。
 // size_t index: 这是一个索引，表示内存块的类型或大小，决定该块归还到哪个空闲链表。
-void CentralCache::returnRange(void* start, size_t size, size_t index) {
+void CentralCache::returnRange(void* start, size_t count, size_t index) {
     if(!start || index >= FREE_LIST_SIZE) {
         return;
     }
@@ -155,48 +272,495 @@ void CentralCache::returnRange(void* start, size_t size, size_t index) {
         std::this_thread::yield();
     }
 
+    // 调用方按其他大小类归还的内存块、其他节点的内存块由另一把锁保护，解锁后按所在span的大小类和节点单独归还
+    void* other = nullptr;
     try {
-        // 1. 将归还的链表连接到中心缓存
-        void* end = start;
-        size_t count = 1;
-
-        // 通过这段代码，我们遍历链表直到找到最后一个有效的内存块，并将其标记为链表的末尾
-        while(*reinterpret_cast<void**>(end) != nullptr && count < size) {
-            end = *reinterpret_cast<void**>(end);
-            count++;
-        }
-
-        // 使用 std::memory_order_relaxed 来进行读取操作，因为这里并不需要对内存操作进行同步，只需要读取当前空闲链表的头部
-        void* current = centralFreeList_[index].load(std::memory_order_relaxed);
-        // 头插法（将原有链表接在归还链表后边）
-        *reinterpret_cast<void**>(end) = current;
-        centralFreeList_[index].store(start, std::memory_order_release);
-        // 原链表：centralFreeList_[index] -> [X] -> [Y] -> ...
-        // 归还链表：[start] -> [...] -> [end]
-        // 连接后：
-        // centralFreeList_[index] -> [start] -> [...] -> [end] -> [X] -> [Y] -> ...
-
+        // 相邻归还的内存块通常来自同一span，先在局部串成一段，span变化时再一次性接到span的空闲链表
+        SpanInfo* span = nullptr;
+        char* spanBegin = nullptr;
+        char* spanEnd = nullptr;
+        void* head = nullptr;
+        void* tail = nullptr;
+        size_t n = 0;
+        bool emptied = false;
+        void* block = start;
+        for(size_t i = 0; i < count; ++i) {
+            assert(block != nullptr);
+            void* next = *reinterpret_cast<void**>(block);
+            if(static_cast<char*>(block) < spanBegin || static_cast<char*>(block) >= spanEnd) {
+                emptied |= insertBlocks(span, head, tail, n);
+                span = PageMap::get(block);
+                spanBegin = static_cast<char*>(span->start);
+                spanEnd = spanBegin + span->numPages * PageCache::PAGE_SIZE;
+                head = tail = nullptr;
+                n = 0;
+            }
+            if(span->index != index || span->node != node_) {
+                *reinterpret_cast<void**>(block) = other;
+                other = block;
+            } else {
+                // 保持归还时的顺序
+                if(tail) {
+                    *reinterpret_cast<void**>(tail) = block;
+                } else {
+                    head = block;
+                }
+                tail = block;
+                ++n;
+            }
+            block = next;
+        }
+        emptied |= insertBlocks(span, head, tail, n);
+        // 有span变为完全空闲时检查空闲span缓存，链表头部的span刚变为空闲，以它的时间作为当前时间，不必读取时钟
+        if(emptied) {
+            trimEmptySpans(index, emptySpans_[index]->emptySince);
+        }
     } catch(...) {
         // 发生异常时确保释放锁
         locks_[index].clear(std::memory_order_release);
         throw; // 重新抛出异常
     }
     locks_[index].clear(std::memory_order_release);
+
+    while(other) {
+        void* next = *reinterpret_cast<void**>(other);
+        *reinterpret_cast<void**>(other) = nullptr;
+        SpanInfo* span = PageMap::get(other);
+        getInstance(span->node).returnRange(other, 1, span->index);
+        other = next;
+    }
+
+    // 其他大小类缓存的空闲span只在本类有活动时才检查，总量超出上限时在这里跨大小类清理
+    if(emptyBytes_.load(std::memory_order_relaxed) > MAX_EMPTY_BYTES) {
+        trimEmptyClasses();
+    }
+}
+
+// 先把内存块全部取出再一次性放回：边取边放的话，fetchRange 会反复取到刚放回的内存块
+void CentralCache::reserve(size_t index, size_t count, bool prefault) {
+    if(index >= FREE_LIST_SIZE || count == 0) {
+        return;
+    }
+
+    size_t size = (index + 1) * ALIGNMENT;
+    void* head = nullptr;
+    void* tail = nullptr;
+    size_t total = 0;
+    while(total < count) {
+        void* start = fetchRange(index, count - total);
+        if(!start) {
+            break;
+        }
+        if(tail) {
+            *reinterpret_cast<void**>(tail) = start;
+        } else {
+            head = start;
+        }
+
+        for(void* block = start; block; block = *reinterpret_cast<void**>(block)) {
+            // 第一页已在写入链表指针时触发缺页，只需写后面的页。
+            // 空闲内存块的内容没有要求，写入0也不会破坏新span全为零的性质
+            if(prefault) {
+                for(size_t offset = PageCache::PAGE_SIZE; offset < size; offset += PageCache::PAGE_SIZE) {
+                    static_cast<volatile char*>(block)[offset] = 0;
+                }
+            }
+            tail = block;
+            ++total;
+        }
+    }
+
+    // 大页模式下把已触发缺页的内存块所在的大页逐个合并为透明大页。
+    // 同一个span的内存块地址连续，只跳过与上一个相同的大页即可
+    if(prefault && head && PageCache::getInstance().hugePages()) {
+        uintptr_t last = 0;
+        for(void* block = head; block; block = *reinterpret_cast<void**>(block)) {
+            uintptr_t base = reinterpret_cast<uintptr_t>(block) & ~(PageCache::HUGE_PAGE_SIZE - 1);
+            if(base != last) {
+                PageCache::collapseHugePages(reinterpret_cast<void*>(base), PageCache::HUGE_PAGE_SIZE);
+                last = base;
+            }
+        }
+    }
+
+    if(head) {
+        // 先登记预留的span数，归还后变为完全空闲的span不会被归还页缓存
+        size_t perSpan = classSpanBlocks(index);
+        while(locks_[index].test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        reservedSpans_[index] = std::max(reservedSpans_[index], (total + perSpan - 1) / perSpan);
+        locks_[index].clear(std::memory_order_release);
+
+        returnRange(head, total, index);
+    }
 }
 
+SpanInfo* CentralCache::carveSpan(size_t index, RemoteFreeQueue* owner, bool* zeroed) {
+    size_t size = (index + 1) * ALIGNMENT;
+    char* start = static_cast<char*>(fetchFromPageCache(size, zeroed));
+    if(!start) {
+        return nullptr;
+    }
+    size_t numPages = classSpanPages(index);
+
+    // 计算总块数，超过32KB的内存块独占按实际大小申请的span，只有一块
+    size_t totalBlocks = classSpanBlocks(index);
+
+    // 独占span的内存块可能被 reallocate 调整成其他大小类，不记录所有者，总在释放线程本地回收
+    if(totalBlocks == 1) {
+        owner = nullptr;
+    }
+
+    // 不在这里切分：写入每个内存块的链表指针会让span的每一页都触发缺页，
+    // 内存块在取出时才由 takeBlocks 切出
+    void* memory = MetadataArena::allocate(sizeof(SpanInfo));
+    SpanInfo* span = memory ? new (memory) SpanInfo{start, numPages, index, owner, node_, nullptr, totalBlocks, totalBlocks,
+                                                    0, false, nullptr, nullptr, {}}
+                            : nullptr;
+    // 归还内存块时依赖 PageMap 找到所在span，登记失败时放弃这个span
+    if(!span || !PageMap::set(start, numPages, span)) {
+        if(span) {
+            PageMap::set(start, numPages, nullptr);
+            MetadataArena::deallocate(span, sizeof(SpanInfo));
+        }
+        PageCache::getInstance().deallocateSpan(start, numPages);
+        return nullptr;
+    }
+
+    ++spanCount_[index];
+    linkSpan(span);
+    return span;
+}
 
-void* CentralCache::fetchFromPageCache(size_t size) {
-    // 1. 计算实际需要的页数
-    size_t numPages = (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
+void* CentralCache::takeBlocks(SpanInfo* span, size_t n, void** last) {
+    size_t linked = span->freeCount - (span->totalBlocks - span->carved);
+    size_t fromList = std::min(n, linked);
+    void* head = nullptr;
+    void* tail = nullptr;
+    if(fromList > 0) {
+        head = tail = span->freeList;
+        for(size_t i = 1; i < fromList; ++i) {
+            tail = *reinterpret_cast<void**>(tail);
+        }
+        span->freeList = *reinterpret_cast<void**>(tail);
+        *reinterpret_cast<void**>(tail) = nullptr;
+    }
+    if(n > fromList) {
+        void* carvedTail = nullptr;
+        void* carvedHead = linkSpanBlocks(span, span->carved, span->carved + n - fromList, &carvedTail);
+        span->carved += n - fromList;
+        if(tail) {
+            *reinterpret_cast<void**>(tail) = carvedHead;
+        } else {
+            head = carvedHead;
+        }
+        tail = carvedTail;
+    }
+    span->freeCount -= n;
+    *last = tail;
+    return head;
+}
 
-    // 2. 根据大小决定分配策略
-    if(size <= SPAN_PAGES * PageCache::PAGE_SIZE) {
-        // 小于等于32KB的请求，使用固定8页
-        return PageCache::getInstance().allocateSpan(SPAN_PAGES);
+bool CentralCache::insertBlocks(SpanInfo* span, void* head, void* tail, size_t n) {
+    if(n == 0) {
+        return false;
+    }
+    *reinterpret_cast<void**>(tail) = span->freeList;
+    span->freeList = head;
+    // 占用率变化后按新的桶挂回；span由满变为有空闲时重新参与分配
+    if(!span->held && span->freeCount > 0) {
+        unlinkSpan(span);
+    }
+    span->freeCount += n;
+    bool emptied = !span->held && span->freeCount == span->totalBlocks;
+    // 完全空闲时丢弃链表，下次重新按地址顺序切分
+    if(emptied) {
+        span->freeList = nullptr;
+        span->carved = 0;
+    }
+    if(!span->held) {
+        linkSpan(span);
+    }
+    return emptied;
+}
+
+size_t CentralCache::occupancyBucket(const SpanInfo* span) {
+    // freeCount > 0 时已分配块数小于总数，桶号落在 [0, OCCUPANCY_BUCKETS)
+    return (span->totalBlocks - span->freeCount) * OCCUPANCY_BUCKETS / span->totalBlocks;
+}
+
+SpanInfo* CentralCache::fullestSpan(size_t index) {
+    for(size_t bucket = OCCUPANCY_BUCKETS; bucket-- > 0;) {
+        if(spanLists_[index][bucket]) {
+            return spanLists_[index][bucket];
+        }
+    }
+    // 最近空闲的span最可能还在缓存中
+    return emptySpans_[index];
+}
+
+void CentralCache::linkSpan(SpanInfo* span) {
+    size_t index = span->index;
+    bool empty = span->freeCount == span->totalBlocks;
+    SpanInfo*& head = empty ? emptySpans_[index] : spanLists_[index][occupancyBucket(span)];
+    span->prev = nullptr;
+    span->next = head;
+    if(head) {
+        head->prev = span;
+    } else if(empty) {
+        emptyTail_[index] = span;
+    }
+    head = span;
+    if(empty) {
+        span->emptySince = std::chrono::steady_clock::now();
+        if(emptyCount_[index]++ == 0) {
+            emptyClasses_[index / 64].fetch_or(uint64_t(1) << (index % 64), std::memory_order_relaxed);
+        }
+        emptyBytes_.fetch_add(span->numPages * PageCache::PAGE_SIZE, std::memory_order_relaxed);
+    }
+}
+
+void CentralCache::unlinkSpan(SpanInfo* span) {
+    size_t index = span->index;
+    bool empty = span->freeCount == span->totalBlocks;
+    if(span->prev) {
+        span->prev->next = span->next;
+    } else if(empty) {
+        emptySpans_[index] = span->next;
     } else {
-        // 大于32KB的请求，按实际需求分配
-        return PageCache::getInstance().allocateSpan(numPages);
+        spanLists_[index][occupancyBucket(span)] = span->next;
+    }
+    if(span->next) {
+        span->next->prev = span->prev;
+    } else if(empty) {
+        emptyTail_[index] = span->prev;
+    }
+    if(empty) {
+        if(--emptyCount_[index] == 0) {
+            emptyClasses_[index / 64].fetch_and(~(uint64_t(1) << (index % 64)), std::memory_order_relaxed);
+        }
+        emptyBytes_.fetch_sub(span->numPages * PageCache::PAGE_SIZE, std::memory_order_relaxed);
+    }
+    span->prev = nullptr;
+    span->next = nullptr;
+}
+
+void CentralCache::trimEmptySpans(size_t index, std::chrono::steady_clock::time_point now) {
+    size_t reserved = reservedSpans_[index];
+    if(emptyCount_[index] <= reserved) {
+        return;
+    }
+
+    size_t spanBytes = classSpanPages(index) * PageCache::PAGE_SIZE;
+    size_t limit = std::max({reserved, EMPTY_SPAN_BYTES / spanBytes, size_t(1)});
+    while(emptyCount_[index] > limit) {
+        freeSpan(emptyTail_[index]);
+    }
+
+    // 链表尾部是最早空闲的span
+    while(emptyCount_[index] > reserved && now - emptyTail_[index]->emptySince >= EMPTY_SPAN_DELAY) {
+        freeSpan(emptyTail_[index]);
+    }
+}
+
+void CentralCache::trimAgedSpans(size_t index) {
+    // 空闲span不超过预留数时什么都不会归还，不必读取时钟
+    if(emptyCount_[index] > reservedSpans_[index]) {
+        trimEmptySpans(index, std::chrono::steady_clock::now());
+    }
+}
+
+void CentralCache::trimEmptyClasses() {
+    if(sweeping_.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    // 第一遍只归还空闲太久的span，总量仍超出上限时第二遍归还预留之外的全部空闲span
+    for(bool force : {false, true}) {
+        if(force && emptyBytes_.load(std::memory_order_relaxed) <= MAX_EMPTY_BYTES) {
+            break;
+        }
+        for(size_t word = 0; word < emptyClasses_.size(); ++word) {
+            uint64_t bits = emptyClasses_[word].load(std::memory_order_relaxed);
+            while(bits) {
+                size_t index = word * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                bits &= bits - 1;
+                // 不等待：持有锁的线程正在使用这个大小类，它自己会检查空闲span
+                if(locks_[index].test_and_set(std::memory_order_acquire)) {
+                    continue;
+                }
+                if(!force) {
+                    trimEmptySpans(index, now);
+                } else {
+                    while(emptyCount_[index] > reservedSpans_[index]) {
+                        freeSpan(emptyTail_[index]);
+                    }
+                }
+                locks_[index].clear(std::memory_order_release);
+            }
+        }
+    }
+    sweeping_.clear(std::memory_order_release);
+}
+
+void CentralCache::freeSpan(SpanInfo* span) {
+    unlinkSpan(span);
+    --spanCount_[span->index];
+    void* start = span->start;
+    size_t numPages = span->numPages;
+    // span中的内存块都在空闲链表中，没有其他线程会再通过 PageMap 查找这些页
+    PageMap::set(start, numPages, nullptr);
+    MetadataArena::deallocate(span, sizeof(SpanInfo));
+    PageCache::getInstance().deallocateSpan(start, numPages);
+}
+
+SpanInfo* CentralCache::acquireSpan(size_t index, void** blocks, size_t* count, bool* zeroed, RemoteFreeQueue* owner) {
+    if(index >= FREE_LIST_SIZE) {
+        return nullptr;
+    }
+    while(locks_[index].test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
     }
+
+    SpanInfo* span = fullestSpan(index);
+    bool spanZeroed = false;
+    if(!span) {
+        span = carveSpan(index, owner, &spanZeroed);
+    }
+    void* freeList = nullptr;
+    size_t carved = 0;
+    if(span) {
+        unlinkSpan(span);
+        span->held = true;
+        freeList = span->freeList;
+        carved = span->carved;
+        *count = span->freeCount;
+        span->freeList = nullptr;
+        span->freeCount = 0;
+        span->carved = span->totalBlocks;
+        if(zeroed) {
+            *zeroed = spanZeroed;
+        }
+        trimAgedSpans(index);
+    }
+
+    locks_[index].clear(std::memory_order_release);
+    if(span) {
+        // 取出的内存块只属于调用线程，在锁外排序并切出其余部分：链表中的内存块都在已切出的部分，
+        // 排序后接上按地址顺序切出的内存块，整个链表仍是地址顺序
+        void* rest = carved < span->totalBlocks ? linkSpanBlocks(span, carved, span->totalBlocks, nullptr) : nullptr;
+        *blocks = sortSpanBlocks(span, freeList, rest);
+    }
+    return span;
+}
+
+void CentralCache::releaseSpan(SpanInfo* span) {
+    if(span->node != node_) {
+        getInstance(span->node).releaseSpan(span);
+        return;
+    }
+    size_t index = span->index;
+    while(locks_[index].test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    span->held = false;
+    // 持有期间其他线程归还的内存块留在span中，span重新参与分配
+    if(span->freeCount > 0) {
+        linkSpan(span);
+        if(span->freeCount == span->totalBlocks) {
+            trimEmptySpans(index, span->emptySince);
+        }
+    }
+    locks_[index].clear(std::memory_order_release);
+
+    if(emptyBytes_.load(std::memory_order_relaxed) > MAX_EMPTY_BYTES) {
+        trimEmptyClasses();
+    }
+}
+
+bool CentralCache::resizeBlock(void* ptr, size_t index) {
+    SpanInfo* span = PageMap::get(ptr);
+    if(!span || span->start != ptr || span->totalBlocks != 1 || index >= FREE_LIST_SIZE || classSpanBlocks(index) != 1) {
+        return false;
+    }
+    if(span->node != node_) {
+        return getInstance(span->node).resizeBlock(ptr, index);
+    }
+
+    size_t oldIndex = span->index;
+    if(oldIndex == index) {
+        return true;
+    }
+    // 内存块已分配出去，span不在任何链表中，也不会再被取用；只需确认它没有被线程作为当前span持有
+    while(locks_[oldIndex].test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    bool held = span->held;
+    if(!held) {
+        --spanCount_[oldIndex];
+    }
+    locks_[oldIndex].clear(std::memory_order_release);
+    if(held) {
+        return false;
+    }
+
+    char* start = static_cast<char*>(ptr);
+    size_t oldPages = span->numPages;
+    size_t numPages = classSpanPages(index);
+    bool resized = true;
+    if(numPages > oldPages) {
+        PageCache& pageCache = PageCache::getInstance(node_);
+        // 先扩大页缓存中的span，再把新增的页登记到 PageMap，登记失败时交回新增的页
+        resized = pageCache.growSpan(ptr, numPages);
+        if(resized && !PageMap::set(start + oldPages * PageCache::PAGE_SIZE, numPages - oldPages, span)) {
+            PageMap::set(start + oldPages * PageCache::PAGE_SIZE, numPages - oldPages, nullptr);
+            pageCache.shrinkSpan(ptr, oldPages);
+            resized = false;
+        }
+    } else if(numPages < oldPages) {
+        // 先取消尾部页的登记，再交回页缓存
+        PageMap::set(start + numPages * PageCache::PAGE_SIZE, oldPages - numPages, nullptr);
+        PageCache::getInstance(node_).shrinkSpan(ptr, numPages);
+    }
+    if(resized) {
+        span->numPages = numPages;
+        span->index = index;
+    }
+
+    size_t newIndex = span->index;
+    while(locks_[newIndex].test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    ++spanCount_[newIndex];
+    locks_[newIndex].clear(std::memory_order_release);
+    return resized;
+}
+
+size_t CentralCache::classSpanPages(size_t index) {
+    return SPAN_PAGES_TABLE.pages[index];
+}
+
+size_t CentralCache::classSpanBlocks(size_t index) {
+    return std::max(size_t(1), classSpanPages(index) * PageCache::PAGE_SIZE / ((index + 1) * ALIGNMENT));
+}
+
+SizeClassStats CentralCache::getStats(size_t index) {
+    size_t size = (index + 1) * ALIGNMENT;
+    size_t pages = classSpanPages(index);
+    size_t blocks = classSpanBlocks(index);
+    while(locks_[index].test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    size_t spans = spanCount_[index];
+    locks_[index].clear(std::memory_order_release);
+    // 独占span的内存块虽然可以通过 allocateAtLeast 用满整个span，按申请大小使用时尾部同样浪费
+    size_t waste = pages * PageCache::PAGE_SIZE - blocks * size;
+    return SizeClassStats{size, pages, blocks, spans, spans * waste};
+}
+
+void* CentralCache::fetchFromPageCache(size_t size, bool* zeroed) {
+    return PageCache::getInstance(node_).allocateSpan(classSpanPages(SizeClass::getIndex(size)), zeroed);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "Heap.h"
+#include "CentralCache.h"
+#include "PageCache.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <new>
+
+namespace MemoryPoolv2 {
+namespace {
+// 线程缓存只缓存不超过 1KB 的小对象，更大的对象直接加锁访问堆
+constexpr size_t SLICE_MAX_BYTES = 1024;
+constexpr size_t SLICE_CLASSES = SLICE_MAX_BYTES / ALIGNMENT;
+// 每个线程同时为最多 SLICE_SLOTS 个堆保留缓存，按 id 直接映射
+constexpr size_t SLICE_SLOTS = 4;
+// 每次从堆中批量取出的数量，以及线程缓存中每个大小类的上限
+constexpr size_t SLICE_BATCH = 16;
+constexpr size_t SLICE_MAX_LENGTH = 64;
+
+std::atomic<uint64_t> nextHeapId{1};
+
+uint64_t newHeapId() {
+    return nextHeapId.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace
+
+// 堆的存活状态，比堆本身活得长：堆析构后控制块放回空闲链表给新的堆复用，从不释放，
+// 其他线程的缓存因此总能安全地检查所属的堆是否存活
+struct HeapControl {
+    // 保护 id 的检查与向堆归还内存块，destroy 更换 id 时也要获取它
+    std::mutex mutex;
+    // 堆当前的 id，每次 destroy 后更换，堆析构后为 0
+    uint64_t id = 0;
+    HeapControl* nextFree = nullptr;
+};
+
+namespace {
+std::mutex controlMutex;
+HeapControl* freeControls = nullptr;
+
+// 只在堆构造和析构时调用
+HeapControl* acquireControl(uint64_t id) {
+    HeapControl* control = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        control = freeControls;
+        if(control) {
+            freeControls = control->nextFree;
+        }
+    }
+    if(!control) {
+        void* memory = MetadataArena::allocate(sizeof(HeapControl));
+        if(!memory) {
+            throw std::bad_alloc();
+        }
+        control = new (memory) HeapControl();
+    }
+    std::lock_guard<std::mutex> lock(control->mutex);
+    control->id = id;
+    return control;
+}
+
+void releaseControl(HeapControl* control) {
+    {
+        std::lock_guard<std::mutex> lock(control->mutex);
+        control->id = 0;
+    }
+    std::lock_guard<std::mutex> lock(controlMutex);
+    control->nextFree = freeControls;
+    freeControls = control;
+}
+} // namespace
+
+// 一个线程为某个堆保留的缓存
+struct HeapSlice {
+    uint64_t heapId = 0;
+    Heap* heap = nullptr;
+    HeapControl* control = nullptr;
+    std::array<void*, SLICE_CLASSES> freeList{};
+    std::array<size_t, SLICE_CLASSES> freeListSize{};
+
+    // 把缓存的内存块还给所属的堆；堆已经被销毁时内存块随span一起释放过了，直接丢弃
+    // 只获取所属堆的控制块的锁，不同堆的缓存互不影响
+    void flush() {
+        if(heapId != 0) {
+            std::lock_guard<std::mutex> lock(control->mutex);
+            if(control->id == heapId) {
+                for(size_t index = 0; index < SLICE_CLASSES; ++index) {
+                    returnAll(index);
+                }
+            }
+        }
+        heapId = 0;
+        heap = nullptr;
+        control = nullptr;
+        freeList.fill(nullptr);
+        freeListSize.fill(0);
+    }
+
+    void returnAll(size_t index) {
+        void* start = freeList[index];
+        if(!start) {
+            return;
+        }
+        void* end = start;
+        while(*reinterpret_cast<void**>(end)) {
+            end = *reinterpret_cast<void**>(end);
+        }
+        heap->returnRange(start, end, index);
+        freeList[index] = nullptr;
+        freeListSize[index] = 0;
+    }
+};
+
+namespace {
+struct SliceTable {
+    std::array<HeapSlice, SLICE_SLOTS> slots;
+
+    ~SliceTable() {
+        for(HeapSlice& slice : slots) {
+            slice.flush();
+        }
+    }
+};
+
+// 取出 id 对应的槽位，槽位被其他堆占用时先清空
+HeapSlice& sliceFor(uint64_t id, Heap* heap, HeapControl* control) {
+    static thread_local SliceTable table;
+    HeapSlice& slice = table.slots[id % SLICE_SLOTS];
+    if(slice.heapId != id) {
+        slice.flush();
+        slice.heapId = id;
+        slice.heap = heap;
+        slice.control = control;
+    }
+    return slice;
+}
+} // namespace
+
+Heap::Heap()
+    : id_(newHeapId())
+    , control_(acquireControl(id_))
+    , freeList_(nullptr)
+{}
+
+Heap::~Heap() {
+    destroy();
+    releaseControl(control_);
+}
+
+void* Heap::allocate(size_t size) {
+    if(size == 0) {
+        size = ALIGNMENT;
+    }
+
+    if(size > MAX_BYTES) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return allocateSpan((size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE);
+    }
+
+    size_t index = SizeClass::getIndex(size);
+    if(size > SLICE_MAX_BYTES) {
+        return fetchRange(index, 1);
+    }
+
+    HeapSlice& slice = sliceFor(id_, this, control_);
+    void* ptr = slice.freeList[index];
+    if(!ptr) {
+        ptr = fetchRange(index, SLICE_BATCH);
+        if(!ptr) {
+            return nullptr;
+        }
+        // 链表中除第一个以外的内存块留在线程缓存
+        size_t count = 0;
+        for(void* p = ptr; p; p = *reinterpret_cast<void**>(p)) {
+            ++count;
+        }
+        slice.freeListSize[index] = count;
+    }
+    slice.freeList[index] = *reinterpret_cast<void**>(ptr);
+    --slice.freeListSize[index];
+    return ptr;
+}
+
+void Heap::deallocate(void* ptr, size_t size) {
+    if(!ptr) {
+        return;
+    }
+
+    if(size > MAX_BYTES) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = spans_.find(ptr);
+        if(it != spans_.end()) {
+            PageCache::getInstance().deallocateSpan(ptr, it->second);
+            spans_.erase(it);
+        }
+        return;
+    }
+
+    size_t index = SizeClass::getIndex(size);
+    if(size > SLICE_MAX_BYTES) {
+        *reinterpret_cast<void**>(ptr) = nullptr;
+        returnRange(ptr, ptr, index);
+        return;
+    }
+
+    HeapSlice& slice = sliceFor(id_, this, control_);
+    *reinterpret_cast<void**>(ptr) = slice.freeList[index];
+    slice.freeList[index] = ptr;
+    if(++slice.freeListSize[index] > SLICE_MAX_LENGTH) {
+        slice.returnAll(index);
+    }
+}
+
+void Heap::destroy() {
+    // 更换 id 后其他线程的缓存在下次访问对应槽位时发现 id 不一致后丢弃；
+    // 正在归还的线程持有控制块的锁，等它完成后才释放span
+    uint64_t newId = newHeapId();
+    {
+        std::lock_guard<std::mutex> lock(control_->mutex);
+        control_->id = newId;
+    }
+    // 当前线程的缓存直接作废
+    {
+        HeapSlice& slice = sliceFor(id_, this, control_);
+        slice.heapId = 0;
+        slice.heap = nullptr;
+        slice.control = nullptr;
+        slice.freeList.fill(nullptr);
+        slice.freeListSize.fill(0);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PageCache& pageCache = PageCache::getInstance();
+        for(const auto& [addr, numPages] : spans_) {
+            pageCache.deallocateSpan(addr, numPages);
+        }
+        spans_.clear();
+        if(freeList_) {
+            PageCache::systemFreeLarge(freeList_, FREE_LIST_SIZE * sizeof(void*));
+            freeList_ = nullptr;
+        }
+    }
+
+    id_ = newId;
+}
+
+size_t Heap::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pages = 0;
+    for(const auto& span : spans_) {
+        pages += span.second;
+    }
+    return pages * PageCache::PAGE_SIZE;
+}
+
+void* Heap::fetchRange(size_t index, size_t batchNum) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!freeList_) {
+        // 直接映射，内核保证全为零，相当于所有链表为空
+        freeList_ = static_cast<void**>(PageCache::systemAllocLarge(FREE_LIST_SIZE * sizeof(void*)));
+        if(!freeList_) {
+            return nullptr;
+        }
+    }
+    if(!freeList_[index]) {
+        refill(index);
+        if(!freeList_[index]) {
+            return nullptr;
+        }
+    }
+
+    void* start = freeList_[index];
+    void* end = start;
+    for(size_t i = 1; i < batchNum && *reinterpret_cast<void**>(end); ++i) {
+        end = *reinterpret_cast<void**>(end);
+    }
+    freeList_[index] = *reinterpret_cast<void**>(end);
+    *reinterpret_cast<void**>(end) = nullptr;
+    return start;
+}
+
+void Heap::returnRange(void* start, void* end, size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *reinterpret_cast<void**>(end) = freeList_[index];
+    freeList_[index] = start;
+}
+
+void* Heap::allocateSpan(size_t numPages) {
+    void* span = PageCache::getInstance().allocateSpan(numPages);
+    if(span) {
+        spans_[span] = numPages;
+    }
+    return span;
+}
+
+// 与 CentralCache 相同的切分方式：按大小类的span页数表切分，超过32KB的每块独占一个span
+void Heap::refill(size_t index) {
+    size_t size = (index + 1) * ALIGNMENT;
+    char* start = static_cast<char*>(allocateSpan(CentralCache::classSpanPages(index)));
+    if(!start) {
+        return;
+    }
+
+    size_t totalBlocks = CentralCache::classSpanBlocks(index);
+    for(size_t i = 1; i < totalBlocks; ++i) {
+        *reinterpret_cast<void**>(start + (i - 1) * size) = start + i * size;
+    }
+    *reinterpret_cast<void**>(start + (totalBlocks - 1) * size) = nullptr;
+    freeList_[index] = start;
+}
+} // namespace MemoryPoolv2
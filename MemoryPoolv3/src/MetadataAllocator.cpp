@@ -0,0 +1,107 @@
+#include "MetadataAllocator.h"
+#include <sys/mman.h>
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace MemoryPoolv2 {
+namespace {
+// 元数据按 16 字节分级，不超过 MAX_SMALL_META 的请求从空闲链表或当前片段中切分，
+// 更大的请求（如 unordered_map 的桶数组）直接 mmap
+constexpr size_t META_ALIGNMENT = 16;
+constexpr size_t MAX_SMALL_META = 512;
+constexpr size_t META_CLASS_NUM = MAX_SMALL_META / META_ALIGNMENT;
+// 每次向系统申请的片段大小
+constexpr size_t META_CHUNK_SIZE = 64 * 1024;
+
+// 元数据的申请释放都很少，用一把自旋锁保护即可
+struct MetadataState {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    std::array<void*, META_CLASS_NUM> freeList{};
+    char* cur = nullptr;
+    char* end = nullptr;
+};
+
+MetadataState& state() {
+    // 常量初始化，不依赖动态初始化顺序，也不会在退出时析构
+    static MetadataState instance;
+    return instance;
+}
+
+void* systemAlloc(size_t size) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+} // namespace
+
+void* MetadataArena::allocate(size_t size) {
+    size = (size + META_ALIGNMENT - 1) & ~(META_ALIGNMENT - 1);
+    if(size == 0) {
+        size = META_ALIGNMENT;
+    }
+    if(size > MAX_SMALL_META) {
+        return systemAlloc(size);
+    }
+
+    MetadataState& s = state();
+    size_t index = size / META_ALIGNMENT - 1;
+    while(s.lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    void* result = s.freeList[index];
+    if(result) {
+        s.freeList[index] = *reinterpret_cast<void**>(result);
+    } else {
+        if(s.cur == nullptr || s.cur + size > s.end) {
+            // 当前片段剩余部分直接丢弃，元数据总量很小
+            char* chunk = static_cast<char*>(systemAlloc(META_CHUNK_SIZE));
+            if(!chunk) {
+                s.lock.clear(std::memory_order_release);
+                return nullptr;
+            }
+            s.cur = chunk;
+            s.end = chunk + META_CHUNK_SIZE;
+        }
+        result = s.cur;
+        s.cur += size;
+    }
+
+    s.lock.clear(std::memory_order_release);
+    return result;
+}
+
+void MetadataArena::lockAll() {
+    MetadataState& s = state();
+    while(s.lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void MetadataArena::unlockAll() {
+    state().lock.clear(std::memory_order_release);
+}
+
+void MetadataArena::deallocate(void* ptr, size_t size) {
+    if(!ptr) {
+        return;
+    }
+    size = (size + META_ALIGNMENT - 1) & ~(META_ALIGNMENT - 1);
+    if(size == 0) {
+        size = META_ALIGNMENT;
+    }
+    if(size > MAX_SMALL_META) {
+        munmap(ptr, size);
+        return;
+    }
+
+    MetadataState& s = state();
+    size_t index = size / META_ALIGNMENT - 1;
+    while(s.lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    *reinterpret_cast<void**>(ptr) = s.freeList[index];
+    s.freeList[index] = ptr;
+    s.lock.clear(std::memory_order_release);
+}
+} // namespace MemoryPoolv2
@@ -0,0 +1,70 @@
+#include "Numa.h"
+#include "PageCache.h"
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace MemoryPoolv2 {
+namespace {
+// 节点掩码只用一个 unsigned long；按 libnuma 的约定 maxnode 传位数 + 1
+constexpr unsigned long MASK_BITS = Numa::MAX_NODES + 1;
+
+// 在内存池第一次分配时调用，不能使用会分配内存的函数
+size_t detectNodeCount() {
+    if(const char* env = getenv("MEMORYPOOL_NUMA_NODES")) {
+        long count = strtol(env, nullptr, 10);
+        if(count >= 1) {
+            return static_cast<size_t>(std::min<long>(count, Numa::MAX_NODES));
+        }
+    }
+
+    int mode = 0;
+    unsigned long mask = 0;
+    if(syscall(SYS_get_mempolicy, &mode, &mask, MASK_BITS, nullptr, MPOL_F_MEMS_ALLOWED) != 0 || mask == 0) {
+        return 1;
+    }
+    return 64 - __builtin_clzl(mask);
+}
+} // namespace
+
+size_t Numa::nodeCount() {
+    static const size_t count = detectNodeCount();
+    return count;
+}
+
+// 线程之后被调度到其他节点时不再更新，已分配的内存仍在原节点
+size_t Numa::currentNode() {
+    static thread_local int node = -1;
+    if(node < 0) {
+        unsigned cpu = 0;
+        unsigned current = 0;
+        if(syscall(SYS_getcpu, &cpu, &current, nullptr) != 0 || current >= nodeCount()) {
+            current = 0;
+        }
+        node = static_cast<int>(current);
+    }
+    return static_cast<size_t>(node);
+}
+
+void Numa::bindMemory(void* ptr, size_t size, size_t node) {
+    if(nodeCount() <= 1 || node >= MAX_NODES) {
+        return;
+    }
+    unsigned long mask = 1UL << node;
+    // 失败（节点不存在或没有内存、内核不支持）时保留默认的首次访问策略
+    syscall(SYS_mbind, ptr, size, MPOL_PREFERRED, &mask, MASK_BITS, 0);
+}
+
+int Numa::pageNode(const void* ptr) {
+    void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ptr) & ~(PageCache::PAGE_SIZE - 1));
+    int status = -1;
+    // nodes 为空时 move_pages 不迁移，只在 status 中返回页所在的节点或负的错误码
+    if(syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) != 0 || status < 0) {
+        return -1;
+    }
+    return status;
+}
+} // namespace MemoryPoolv2
@@ -1,60 +1,264 @@
 #include "PageCache.h"
 #include <sys/mman.h>
+#include <algorithm>
 #include <cstring>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+// 较早的 glibc 头文件中没有 MADV_COLLAPSE（Linux 6.1 引入），不支持的内核返回 EINVAL
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
 
 namespace MemoryPoolv2 {
+std::atomic<bool> PageCache::hugePages_{false};
+
+namespace {
+// 多节点时每个预留区域所属的节点，释放span时据此找到对应节点的实例
+// 表项按起始地址排序，查找时二分；区域从不解除映射，表只增不减
+// 表满时从元数据分配器申请两倍大小的新表复制过去，旧表不释放（并发的查找可能仍在读取）
+// 查找不加锁，用顺序锁检测并发的插入：插入期间 regionTableSeq 为奇数，
+// 查找前后读到的序号不同时重试。表项用原子变量保存，写入用 release、读取用 acquire：
+// 读到插入过程中写入的表项时，之后一定能读到插入开始时增加的序号
+struct RegionEntry {
+    std::atomic<uintptr_t> start;
+    std::atomic<uintptr_t> end;
+    std::atomic<size_t> node;
+};
+constexpr size_t INITIAL_REGION_ENTRIES = 4096;
+RegionEntry initialRegionTable[INITIAL_REGION_ENTRIES];
+// 查找先读表项数再读表：换表后才增加表项数，读到新的表项数时一定读到新表
+std::atomic<RegionEntry*> regionTable{initialRegionTable};
+std::atomic<size_t> regionTableSize{0};
+// 只在持有 regionTableMutex 时访问
+size_t regionTableCapacity = INITIAL_REGION_ENTRIES;
+std::atomic<uint64_t> regionTableSeq{0};
+std::mutex regionTableMutex;
+
+// addr 所在区域的节点，不在任何区域中时返回 -1
+long findRegionNode(uintptr_t addr) {
+    while(true) {
+        uint64_t seq = regionTableSeq.load(std::memory_order_acquire);
+        if(seq & 1) {
+            // 插入只移动表项，很快结束
+            std::this_thread::yield();
+            continue;
+        }
+        // 最后一个起始地址不大于 addr 的区域
+        size_t lo = 0;
+        size_t hi = regionTableSize.load(std::memory_order_acquire);
+        const RegionEntry* table = regionTable.load(std::memory_order_acquire);
+        while(lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if(table[mid].start.load(std::memory_order_acquire) <= addr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        long node = -1;
+        if(lo > 0 && addr < table[lo - 1].end.load(std::memory_order_acquire)) {
+            node = static_cast<long>(table[lo - 1].node.load(std::memory_order_acquire));
+        }
+        if(regionTableSeq.load(std::memory_order_relaxed) == seq) {
+            return node;
+        }
+    }
+}
+// 换成两倍大小的新表，需持有 regionTableMutex。新表在发布前填好，
+// 查找读到新表时其中已有全部表项，读到旧表时旧表也仍然有效
+RegionEntry* growRegionTable(RegionEntry* table, size_t count) {
+    size_t capacity = regionTableCapacity * 2;
+    void* memory = MetadataArena::allocate(capacity * sizeof(RegionEntry));
+    if(!memory) {
+        return nullptr;
+    }
+    RegionEntry* grown = static_cast<RegionEntry*>(memory);
+    for(size_t i = 0; i < capacity; ++i) {
+        new (&grown[i]) RegionEntry();
+    }
+    for(size_t i = 0; i < count; ++i) {
+        grown[i].start.store(table[i].start.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        grown[i].end.store(table[i].end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        grown[i].node.store(table[i].node.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    regionTable.store(grown, std::memory_order_release);
+    regionTableCapacity = capacity;
+    return grown;
+}
+} // namespace
+
+PageCache* PageCache::createInstances(void* storage) {
+    PageCache* instances = static_cast<PageCache*>(storage);
+    for(size_t node = 0; node < Numa::nodeCount(); ++node) {
+        new (&instances[node]) PageCache(node);
+    }
+    return instances;
+}
+
+void PageCache::lockAll() {
+    for(size_t node = 0; node < Numa::nodeCount(); ++node) {
+        getInstance(node).mutex_.lock();
+    }
+    regionTableMutex.lock();
+}
+
+void PageCache::unlockAll() {
+    regionTableMutex.unlock();
+    for(size_t node = Numa::nodeCount(); node-- > 0;) {
+        getInstance(node).mutex_.unlock();
+    }
+}
+
+PageCache& PageCache::owner(const void* ptr) {
+    if(Numa::nodeCount() > 1) {
+        long node = findRegionNode(reinterpret_cast<uintptr_t>(ptr));
+        if(node >= 0) {
+            return getInstance(static_cast<size_t>(node));
+        }
+    }
+    return *this;
+}
+
+void* PageCache::registerRegion(void* memory, size_t size) {
+    if(Numa::nodeCount() <= 1) {
+        return memory;
+    }
+    {
+        std::lock_guard<std::mutex> lock(regionTableMutex);
+        size_t count = regionTableSize.load(std::memory_order_relaxed);
+        RegionEntry* table = regionTable.load(std::memory_order_relaxed);
+        if(count == regionTableCapacity) {
+            table = growRegionTable(table, count);
+            if(!table) {
+                munmap(memory, size);
+                return nullptr;
+            }
+        }
+        uintptr_t start = reinterpret_cast<uintptr_t>(memory);
+        uint64_t seq = regionTableSeq.load(std::memory_order_relaxed);
+        regionTableSeq.store(seq + 1, std::memory_order_relaxed);
+        // 插入排序：比新区域靠后的表项后移一位
+        size_t i = count;
+        for(; i > 0 && table[i - 1].start.load(std::memory_order_relaxed) > start; --i) {
+            table[i].start.store(table[i - 1].start.load(std::memory_order_relaxed), std::memory_order_release);
+            table[i].end.store(table[i - 1].end.load(std::memory_order_relaxed), std::memory_order_release);
+            table[i].node.store(table[i - 1].node.load(std::memory_order_relaxed), std::memory_order_release);
+        }
+        table[i].start.store(start, std::memory_order_release);
+        table[i].end.store(start + size, std::memory_order_release);
+        table[i].node.store(node_, std::memory_order_release);
+        regionTableSize.store(count + 1, std::memory_order_release);
+        regionTableSeq.store(seq + 2, std::memory_order_release);
+    }
+    Numa::bindMemory(memory, size, node_);
+    return memory;
+}
+
 // 这个函数的目的是根据请求的页数（numPages），为其分配一个内存块，返回其内存地址。
 // 按页数申请
-void* PageCache::allocateSpan(size_t numPages) {
+void* PageCache::allocateSpan(size_t numPages, bool* zeroed) {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    // 分配也检查空闲时间：程序不再释放时，空闲的span同样会在 RELEASE_DELAY 后交还
+    if(idleTail_) {
+        trimIdleSpans(std::chrono::steady_clock::now());
+    }
+
     // 查找合适的空闲span
     // lower_bound函数返回第一个大于等于numPages的元素的迭代器
     // freeSpans_ 是一个以页数（numPages）为键、Span* 为值的映射容器。lower_bound 函数会查找第一个大于或等于 numPages 的键值。也就是说，it 会指向一个可以满足需求的 span（如果存在的话）
-    auto it = freeSpans_.lower_bound(numPages);
-    if(it != freeSpans_.end()) {
+    // 仍占用物理内存的span中没有足够大的，再从全为零的span中查找
+    FreeSpanMap* spans = &freeSpans_;
+    auto it = spans->lower_bound(numPages);
+    if(it == spans->end()) {
+        spans = &zeroedSpans_;
+        it = spans->lower_bound(numPages);
+    }
+    if(it != spans->end()) {
         Span* span = it->second;
 
-        // 将取出的span从原有的空闲链表freeSpans_[it->first]中移除
-        if(span->next) {
-            freeSpans_[it->first] = span->next;
+        if(hugePages()) {
+            // 优先填满低地址的大页，高地址的大页更容易整体空闲下来
+            span = lowestSpan(*spans, it);
+            removeFreeSpan(span);
         } else {
-            freeSpans_.erase(it);
+            // 将取出的span从原有的空闲链表(*spans)[it->first]中移除
+            if(span->next) {
+                it->second = span->next;
+            } else {
+                spans->erase(it);
+            }
+            if(span->idle) {
+                removeIdle(span);
+            }
         }
 
         // 如果span大于需要的numPages则进行分割
         // 当一个 span 中的页数多于请求的页数时，需要将 span 分成两个部分：一部分用于满足当前的内存请求，另一部分则被放回到空闲链表中
         if(span->numPages > numPages) {
-            Span* newSpan = new Span;
+            Span* newSpan = createSpan();
             // newSpan->pageAddr 是超出部分的起始地址。通过将 span->pageAddr 向后偏移 numPages * PAGE_SIZE，我们得到超出部分的地址。也就是说，newSpan 的起始地址是原 span 地址加上已经分配的页数（numPages）
             newSpan->pageAddr = static_cast<char*>(span->pageAddr) + numPages * PAGE_SIZE;
             newSpan->numPages = span->numPages - numPages;
             newSpan->next = nullptr;
+            newSpan->zeroed = span->zeroed;
 
             // 将超出部分放回空闲Span*列表头部
-            auto& list = freeSpans_[newSpan->numPages];
-            newSpan->next = list;
-            list = newSpan;
+            insertFreeSpan(newSpan);
 
             span->numPages = numPages; // 更新原span的页数
         }
 
+        if(zeroed) {
+            *zeroed = span->zeroed;
+        }
+
         // 记录span信息用于回收
         spanMap_[span->pageAddr] = span;
         return span->pageAddr;
     }
 
-    // 没有合适的span，向系统申请
-    void* memory = systemAlloc(numPages);
+    // 没有合适的span，向系统预留一整块地址空间：
+    // 之后的span从中连续切分，减少 mmap 调用，相邻span释放后也能合并
+    bool huge = hugePages();
+    size_t regionPages = std::max(numPages, nextRegionPages_);
+    if(huge) {
+        constexpr size_t HUGE_PAGES = HUGE_PAGE_SIZE / PAGE_SIZE;
+        regionPages = (regionPages + HUGE_PAGES - 1) / HUGE_PAGES * HUGE_PAGES;
+    }
+    void* memory = systemAlloc(regionPages, huge);
+    if(!memory && regionPages > numPages) {
+        // 地址空间或系统的内存承诺不足时退回到只映射所需的页
+        regionPages = numPages;
+        memory = systemAlloc(regionPages, huge);
+    }
     if(!memory) {
         return nullptr; // 系统分配失败
     }
+    ++regionCount_;
+    nextRegionPages_ = std::min(nextRegionPages_ * 2, MAX_REGION_SIZE / PAGE_SIZE);
 
     // 创建新的span
-    Span* span = new Span;
+    Span* span = createSpan();
     span->pageAddr = memory;
     span->numPages = numPages;
     span->next = nullptr;
+    // 新映射的匿名页由内核保证全为零
+    span->zeroed = true;
+    if(zeroed) {
+        *zeroed = true;
+    }
+
+    // 剩余部分作为全零的空闲span放回
+    if(regionPages > numPages) {
+        Span* rest = createSpan();
+        rest->pageAddr = static_cast<char*>(memory) + numPages * PAGE_SIZE;
+        rest->numPages = regionPages - numPages;
+        rest->zeroed = true;
+        insertFreeSpan(rest);
+    }
 
     // 记录span信息用于回收
     spanMap_[memory] = span;
@@ -63,6 +267,11 @@ void* PageCache::allocateSpan(size_t numPages) {
 
 // 这段代码是一个内存回收的函数，用于释放在 PageCache 中分配的内存块（span）。它的主要任务是将 ptr 指向的内存块（span）释放，并尝试将相邻的空闲内存块（span）合并成一个更大的空闲块，从而减少内存碎片。
 void PageCache::deallocateSpan(void* ptr, size_t numPages) {
+    PageCache& cache = owner(ptr);
+    if(&cache != this) {
+        cache.deallocateSpan(ptr, numPages);
+        return;
+    }
     std::lock_guard<std::mutex> lock(mutex_);
 
     // 查找对应的span，没找到代表不是PageCache分配的内存，直接返回
@@ -71,10 +280,20 @@ void PageCache::deallocateSpan(void* ptr, size_t numPages) {
         return;
     }
 
+    // 先交还长时间空闲的span，避免它们与刚释放的span合并后重新计时
+    trimIdleSpans(std::chrono::steady_clock::now());
+
+    // 使用过的span内容未知
     Span* span = it->second;
+    span->zeroed = false;
+    span = mergeFreeSpan(span);
+    trimIdleSpans(span->freedAt);
+}
 
+PageCache::Span* PageCache::mergeFreeSpan(Span* span) {
     // 尝试合并相邻的span
-    void* nextAddr = static_cast<char*>(ptr) + numPages * PAGE_SIZE;
+    // span 可能被 growSpan 扩大过，以记录的页数为准
+    void* nextAddr = static_cast<char*>(span->pageAddr) + span->numPages * PAGE_SIZE;
     auto nextIt = spanMap_.find(nextAddr);
 
     // 我们要释放一个内存块（span），需要看看它后面相邻的内存块（nextSpan）是不是空闲的。
@@ -84,56 +303,446 @@ void PageCache::deallocateSpan(void* ptr, size_t numPages) {
 
     // | span（空闲，扩大了）          | otherSpan（占用）|
 
-    if(nextIt != spanMap_.end()) {
+    // 只有nextSpan在空闲链表中时才进行合并。
+    // 内容为零与否不同的span不合并：否则刚释放的span会把预留区域中从未使用的部分一起带入空闲时间链表，
+    // 物理页交还后两者都为零，再合并
+    if(nextIt != spanMap_.end() && nextIt->second->zeroed == span->zeroed && removeFreeSpan(nextIt->second)) {
         Span* nextSpan = nextIt->second;
+        // 合并span
+        span->numPages += nextSpan->numPages;
+        spanMap_.erase(nextIt);
+        // 用于释放之前从PageCache中分配出去的内存span。
+        // Span 是一个管理结构，它并不直接代表真正的内存块。
+        // 真正被使用、分配和释放的内存区域由 span->pageAddr 指向，这个地址的内存由单独的机制（例如系统调用）分配和释放
+        // Span 仅仅是记录或描述内存块的元数据
+        // delete nextSpan 仅释放了管理结构Span自身的内存，而不是Span所描述的真正内存块（pages）
+        destroySpan(nextSpan);
+    }
 
-        // 1. 首先检查nextSpan是否在空闲链表中
-        bool found = false;
-        auto& nextList = freeSpans_[nextSpan->numPages];
-
-        // 检查是否是头节点
-        if(nextList == nextSpan) {
-            // 如果是头节点，直接把链表头指针指向下一个节点（nextSpan->next），这样nextSpan就从链表中移除了。
-            // found置为true，表示成功找到并移除。
-            nextList = nextSpan->next;
-            found = true;
-        } else if(nextList) {
-            // 只有在链表非空时才遍历
-            Span* prev = nextList;
-            while(prev->next) {
-                if(prev->next == nextSpan) {
-                    // 将nextSpan从空闲链表中移除
-                    prev->next = nextSpan->next;
-                    found = true;
-                    break;
-                }
-                prev = prev->next;
-            }
-        }
-
-        // 2. 只有在找到nextSpan的情况下才进行合并
-        if(found) {
-            // 合并span
-            span->numPages += nextSpan->numPages;
-            spanMap_.erase(nextAddr);
-            // 用于释放之前从PageCache中分配出去的内存span。
-            // Span 是一个管理结构，它并不直接代表真正的内存块。
-            // 真正被使用、分配和释放的内存区域由 span->pageAddr 指向，这个地址的内存由单独的机制（例如系统调用）分配和释放
-            // Span 仅仅是记录或描述内存块的元数据
-            // delete nextSpan 仅释放了管理结构Span自身的内存，而不是Span所描述的真正内存块（pages）
-            delete nextSpan;
+    // 从预留区域中按地址递增切分的span，后一个往往仍在使用，还要与前一个空闲span合并
+    auto prevIt = spanMap_.lower_bound(span->pageAddr);
+    if(prevIt != spanMap_.begin()) {
+        --prevIt;
+        Span* prevSpan = prevIt->second;
+        if(static_cast<char*>(prevSpan->pageAddr) + prevSpan->numPages * PAGE_SIZE == span->pageAddr
+           && prevSpan->zeroed == span->zeroed && removeFreeSpan(prevSpan)) {
+            prevSpan->numPages += span->numPages;
+            spanMap_.erase(span->pageAddr);
+            destroySpan(span);
+            span = prevSpan;
         }
     }
 
     // 将合并后的span通过头插法插入空闲列表
-    auto& list = freeSpans_[span->numPages];
+    insertFreeSpan(span);
+    return span;
+}
+
+// 原地扩大span：只检查紧随其后的span，空闲且页数足够时从中切下所需的部分并入当前span
+bool PageCache::growSpan(void* ptr, size_t numPages) {
+    PageCache& cache = owner(ptr);
+    if(&cache != this) {
+        return cache.growSpan(ptr, numPages);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = spanMap_.find(ptr);
+    if(it == spanMap_.end()) {
+        return false;
+    }
+    Span* span = it->second;
+    if(span->numPages >= numPages) {
+        return true;
+    }
+
+    size_t needPages = numPages - span->numPages;
+    void* nextAddr = static_cast<char*>(ptr) + span->numPages * PAGE_SIZE;
+    auto nextIt = spanMap_.find(nextAddr);
+    if(nextIt == spanMap_.end() || nextIt->second->numPages < needPages) {
+        return false;
+    }
+    Span* nextSpan = nextIt->second;
+    if(!removeFreeSpan(nextSpan)) {
+        return false; // 相邻span正在使用
+    }
+    spanMap_.erase(nextIt);
+
+    // 多出的部分作为新的空闲span放回
+    if(nextSpan->numPages > needPages) {
+        nextSpan->pageAddr = static_cast<char*>(nextAddr) + needPages * PAGE_SIZE;
+        nextSpan->numPages -= needPages;
+        insertFreeSpan(nextSpan);
+    } else {
+        destroySpan(nextSpan);
+    }
+
+    span->numPages = numPages;
+    return true;
+}
+
+// 按对齐要求分配span：多申请 alignment / PAGE_SIZE - 1 页，
+// 在其中找到对齐的起始页，前后多出的页作为空闲span放回
+void* PageCache::allocateSpanAligned(size_t numPages, size_t alignment, bool* zeroed) {
+    size_t extraPages = alignment / PAGE_SIZE - 1;
+    char* memory = static_cast<char*>(allocateSpan(numPages + extraPages, zeroed));
+    if(!memory) {
+        return nullptr;
+    }
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(memory);
+    char* aligned = reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+    size_t headPages = (aligned - memory) / PAGE_SIZE;
+    size_t tailPages = extraPages - headPages;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Span* span = spanMap_[memory];
+
+    Span* head = nullptr;
+    if(headPages > 0) {
+        // 原span保留为前面的空闲部分，对齐部分使用新的span
+        Span* body = createSpan();
+        body->pageAddr = aligned;
+        body->numPages = numPages;
+        body->next = nullptr;
+        body->zeroed = span->zeroed;
+        spanMap_[aligned] = body;
+
+        span->numPages = headPages;
+        head = span;
+    } else {
+        span->numPages = numPages;
+    }
+
+    // 前后剩余的部分与 deallocateSpan 一样和相邻的空闲span合并，避免预留区域被切成碎片
+    if(tailPages > 0) {
+        Span* tail = createSpan();
+        tail->pageAddr = aligned + numPages * PAGE_SIZE;
+        tail->numPages = tailPages;
+        tail->next = nullptr;
+        tail->zeroed = span->zeroed;
+        mergeFreeSpan(tail);
+    }
+    if(head) {
+        mergeFreeSpan(head);
+    }
+    return aligned;
+}
+
+void PageCache::insertFreeSpan(Span* span, bool idle) {
+    auto& list = (span->zeroed ? zeroedSpans_ : freeSpans_)[span->numPages];
     span->next = list;
     list = span;
+    // 空闲的span也记录在spanMap_中，回收或扩大前一个span时才能找到它进行合并
+    spanMap_[span->pageAddr] = span;
+    if(!span->zeroed && idle) {
+        pushIdle(span);
+    }
 }
 
-// 它的目的是通过系统调用 mmap 向操作系统请求内存，并确保返回的内存块已经被清零。这个函数在内存池的实现中用于当无法从内部空闲内存池分配内存时，向操作系统请求更多的内存。
-void* PageCache::systemAlloc(size_t numPages) {
+bool PageCache::removeFreeSpan(Span* span) {
+    FreeSpanMap& spans = span->zeroed ? zeroedSpans_ : freeSpans_;
+    auto listIt = spans.find(span->numPages);
+    if(listIt == spans.end()) {
+        return false;
+    }
+
+    bool found = false;
+    Span*& head = listIt->second;
+    // 检查是否是头节点
+    if(head == span) {
+        // 如果是头节点，直接把链表头指针指向下一个节点，这样span就从链表中移除了。
+        head = span->next;
+        found = true;
+    } else {
+        Span* prev = head;
+        while(prev->next) {
+            if(prev->next == span) {
+                prev->next = span->next;
+                found = true;
+                break;
+            }
+            prev = prev->next;
+        }
+    }
+
+    // 链表被取空时删除对应的键，否则 allocateSpan 的 lower_bound 可能找到一个空链表头
+    if(head == nullptr) {
+        spans.erase(listIt);
+    }
+    if(found && span->idle) {
+        removeIdle(span);
+    }
+    return found;
+}
+
+void PageCache::pushIdle(Span* span) {
+    span->freedAt = std::chrono::steady_clock::now();
+    span->idle = true;
+    span->idlePrev = nullptr;
+    span->idleNext = idleHead_;
+    if(idleHead_) {
+        idleHead_->idlePrev = span;
+    } else {
+        idleTail_ = span;
+    }
+    idleHead_ = span;
+    idleBytes_ += span->numPages * PAGE_SIZE;
+}
+
+void PageCache::removeIdle(Span* span) {
+    span->idle = false;
+    if(span->idlePrev) {
+        span->idlePrev->idleNext = span->idleNext;
+    } else {
+        idleHead_ = span->idleNext;
+    }
+    if(span->idleNext) {
+        span->idleNext->idlePrev = span->idlePrev;
+    } else {
+        idleTail_ = span->idlePrev;
+    }
+    idleBytes_ -= span->numPages * PAGE_SIZE;
+}
+
+// 只交还物理页、保留映射：span仍留在空闲链表中可以继续分配和合并，
+// 再次使用时由内核按需提供全零的页
+void PageCache::trimIdleSpans(std::chrono::steady_clock::time_point now) {
+    while(idleTail_ && (idleBytes_ > MAX_IDLE_BYTES || now - idleTail_->freedAt >= RELEASE_DELAY)) {
+        Span* span = idleTail_;
+        removeFreeSpan(span);
+        if(hugePages()) {
+            releaseHugePages(span);
+            continue;
+        }
+        madvise(span->pageAddr, span->numPages * PAGE_SIZE, MADV_DONTNEED);
+        span->zeroed = true;
+        mergeFreeSpan(span);
+    }
+}
+
+// 只交还部分页会让内核把透明大页拆回 4KB 页，所以只处理 span 中按大页对齐的完整大页
+void PageCache::releaseHugePages(Span* span) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(span->pageAddr);
+    uintptr_t end = start + span->numPages * PAGE_SIZE;
+    uintptr_t first = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    uintptr_t last = end & ~(HUGE_PAGE_SIZE - 1);
+    if(first >= last) {
+        insertFreeSpan(span, false);
+        return;
+    }
+
+    if(last < end) {
+        Span* tail = createSpan();
+        tail->pageAddr = reinterpret_cast<void*>(last);
+        tail->numPages = (end - last) / PAGE_SIZE;
+        insertFreeSpan(tail, false);
+    }
+    if(first > start) {
+        // 起始地址的登记由 span 换成 head
+        Span* head = createSpan();
+        head->pageAddr = span->pageAddr;
+        head->numPages = (first - start) / PAGE_SIZE;
+        insertFreeSpan(head, false);
+    }
+
+    span->pageAddr = reinterpret_cast<void*>(first);
+    span->numPages = (last - first) / PAGE_SIZE;
+    madvise(span->pageAddr, last - first, MADV_DONTNEED);
+    span->zeroed = true;
+    mergeFreeSpan(span);
+}
+
+size_t PageCache::idleBytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idleBytes_;
+}
+
+namespace {
+// 大页模式下分配span时比较的候选数量
+constexpr size_t FILLER_CANDIDATES = 8;
+} // namespace
+
+PageCache::Span* PageCache::lowestSpan(FreeSpanMap& spans, FreeSpanMap::iterator it) {
+    Span* best = it->second;
+    size_t checked = 0;
+    for(; it != spans.end() && checked < FILLER_CANDIDATES; ++it) {
+        for(Span* span = it->second; span && checked < FILLER_CANDIDATES; span = span->next, ++checked) {
+            if(span->pageAddr < best->pageAddr) {
+                best = span;
+            }
+        }
+    }
+    return best;
+}
+
+void PageCache::setHugePages(bool enable) {
+    hugePages_.store(enable, std::memory_order_relaxed);
+}
+
+void PageCache::collapseHugePages(void* ptr, size_t size) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t first = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    uintptr_t last = (start + size) & ~(HUGE_PAGE_SIZE - 1);
+    if(first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_COLLAPSE);
+    }
+}
+
+size_t PageCache::regionCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return regionCount_;
+}
+
+void PageCache::shrinkSpan(void* ptr, size_t numPages) {
+    PageCache& cache = owner(ptr);
+    if(&cache != this) {
+        cache.shrinkSpan(ptr, numPages);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = spanMap_.find(ptr);
+    if(it == spanMap_.end() || it->second->numPages <= numPages) {
+        return;
+    }
+    Span* span = it->second;
+
+    Span* tail = createSpan();
+    tail->pageAddr = static_cast<char*>(ptr) + numPages * PAGE_SIZE;
+    tail->numPages = span->numPages - numPages;
+    tail->next = nullptr;
+    tail->zeroed = false;
+    span->numPages = numPages;
+    mergeFreeSpan(tail);
+}
+
+namespace {
+size_t pageCount(size_t size) {
+    return (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
+}
+} // namespace
+
+void* PageCache::allocateLarge(size_t size, bool* zeroed) {
+    if(size > MMAP_THRESHOLD) {
+        if(zeroed) {
+            *zeroed = true;
+        }
+        void* ptr = systemAllocLarge(size);
+        if(ptr) {
+            Numa::bindMemory(ptr, size, node_);
+        }
+        return ptr;
+    }
+    // 大页模式下按大页对齐，对象的每个完整大页都能由一个透明大页映射
+    if(size >= HUGE_PAGE_SIZE && hugePages()) {
+        return allocateSpanAligned(pageCount(size), HUGE_PAGE_SIZE, zeroed);
+    }
+    return allocateSpan(pageCount(size), zeroed);
+}
+
+void PageCache::deallocateLarge(void* ptr, size_t size) {
+    if(size > MMAP_THRESHOLD) {
+        systemFreeLarge(ptr, size);
+        return;
+    }
+    deallocateSpan(ptr, pageCount(size));
+}
+
+// 两种来源之间无法原地转换；同为span时向后扩大或把尾部交回
+void* PageCache::reallocateLarge(void* ptr, size_t oldSize, size_t newSize) {
+    bool oldMapped = oldSize > MMAP_THRESHOLD;
+    bool newMapped = newSize > MMAP_THRESHOLD;
+    if(oldMapped && newMapped) {
+        return systemReallocLarge(ptr, oldSize, newSize);
+    }
+    if(oldMapped || newMapped) {
+        return nullptr;
+    }
+
+    size_t numPages = pageCount(newSize);
+    if(!growSpan(ptr, numPages)) {
+        return nullptr;
+    }
+    shrinkSpan(ptr, numPages);
+    return ptr;
+}
+
+namespace {
+size_t largeMapSize(size_t size) {
+    return (size + PageCache::PAGE_SIZE - 1) & ~(PageCache::PAGE_SIZE - 1);
+}
+} // namespace
+
+void* PageCache::systemAllocLarge(size_t size) {
+    void* ptr = mmap(nullptr, largeMapSize(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// 多映射 alignment - PAGE_SIZE 字节，再把对齐地址前后多出的部分解除映射，
+// 剩下的映射与 systemAllocLarge 的完全相同，可以用 systemFreeLarge 释放
+void* PageCache::systemAllocLargeAligned(size_t size, size_t alignment) {
+    size_t len = largeMapSize(size);
+    size_t extra = alignment - PAGE_SIZE;
+    void* ptr = mmap(nullptr, len + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    char* memory = static_cast<char*>(ptr);
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(memory) + alignment - 1) & ~(alignment - 1));
+    size_t head = aligned - memory;
+    if(head > 0) {
+        munmap(memory, head);
+    }
+    if(extra > head) {
+        munmap(aligned + len, extra - head);
+    }
+    return aligned;
+}
+
+void PageCache::systemFreeLarge(void* ptr, size_t size) {
+    munmap(ptr, largeMapSize(size));
+}
+
+// 映射页数不变时直接返回；否则交给内核 mremap，
+// 能原地扩展就原地扩展，不能时内核移动页表项，不需要逐字节拷贝
+void* PageCache::systemReallocLarge(void* ptr, size_t oldSize, size_t newSize) {
+    size_t oldLen = largeMapSize(oldSize);
+    size_t newLen = largeMapSize(newSize);
+    if(oldLen == newLen) {
+        return ptr;
+    }
+    void* result = mremap(ptr, oldLen, newLen, MREMAP_MAYMOVE);
+    return result == MAP_FAILED ? nullptr : result;
+}
+
+void PageCache::discardPages(void* ptr, size_t size) {
+    madvise(ptr, largeMapSize(size), MADV_DONTNEED);
+}
+
+// 它的目的是通过系统调用 mmap 向操作系统请求内存。这个函数在内存池的实现中用于当无法从内部空闲内存池分配内存时，向操作系统请求更多的内存。
+void* PageCache::systemAlloc(size_t numPages, bool hugeAligned) {
     size_t size = numPages * PAGE_SIZE;
+    if(hugeAligned) {
+        // 多映射一个大页，再把对齐地址前后多出的部分解除映射
+        size_t extra = HUGE_PAGE_SIZE - PAGE_SIZE;
+        void* ptr = mmap(nullptr, size + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(ptr == MAP_FAILED) {
+            return nullptr;
+        }
+        char* memory = static_cast<char*>(ptr);
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(memory) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+        size_t head = aligned - memory;
+        if(head > 0) {
+            munmap(memory, head);
+        }
+        if(extra > head) {
+            munmap(aligned + size, extra - head);
+        }
+        // 没有配置 hugetlbfs 大页池时 MAP_HUGETLB 会直接失败，这里使用透明大页，内核不支持时忽略
+        madvise(aligned, size, MADV_HUGEPAGE);
+        return registerRegion(aligned, size);
+    }
 
     // 使用mmap分配内存
     // mmap 是一个系统调用，用来映射文件或设备到内存地址空间，但在这里它用于请求匿名内存, 即与任何文件无关的内存区域。
@@ -142,9 +751,10 @@ void* PageCache::systemAlloc(size_t numPages) {
     // MAP_PRIVATE | MAP_ANONYMOUS: 
     // MAP_PRIVATE 表示创建的映射是私有的，不会影响到其他进程的内存。
     // MAP_ANONYMOUS 表示分配的内存不与任何文件关联，而是匿名内存，通常用于内存池等场景。
+    // MAP_NORESERVE 表示不为整块预留区域预先计入交换空间/内存承诺，页在首次写入时才真正提交
     // -1: 第五个参数表示没有文件描述符，表示内存映射不与任何文件关联，因为我们是申请匿名内存。
     // 0: 第六个参数通常表示文件的偏移量，但在匿名映射中它没有实际意义。
-    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
     // 如果 mmap 调用成功，ptr 会返回映射的内存地址。如果失败，ptr 将会是 MAP_FAILED，表示分配内存失败。
     if(ptr == MAP_FAILED) {
         return nullptr; // 分配失败
@@ -155,11 +765,22 @@ void* PageCache::systemAlloc(size_t numPages) {
     // alignedPtr = (alignedPtr + 7) & ~static_cast<uintptr_t>(7);  // 对齐到 8 字节
     // ptr = reinterpret_cast<void*>(alignedPtr);
 
-    
-    // 清零内存
-    // memset 用于将分配到的内存初始化为零，确保返回的内存块不会包含任何旧数据，符合内存分配的安全标准。
-    memset(ptr, 0, size);
-    return ptr;
+    // 匿名映射的页本身就是零，且在首次访问时才真正分配物理页，这里不再 memset：
+    // 逐页写零会立即触发全部缺页并占满 RSS，即使这些内存块从未被使用
+    // 需要零内存的调用方使用 MemoryPool::allocateZeroed，由 span 的 zeroed 标记决定是否清零
+    return registerRegion(ptr, size);
+}
+
+PageCache::Span* PageCache::createSpan() {
+    void* memory = MetadataArena::allocate(sizeof(Span));
+    if(!memory) {
+        throw std::bad_alloc();
+    }
+    return new (memory) Span();
+}
+
+void PageCache::destroySpan(Span* span) {
+    MetadataArena::deallocate(span, sizeof(Span));
 }
 
 }
\ No newline at end of file
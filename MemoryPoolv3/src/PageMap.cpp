@@ -0,0 +1,50 @@
+#include "PageMap.h"
+#include "PageCache.h"
+#include <mutex>
+
+namespace MemoryPoolv2 {
+static_assert((size_t(1) << PageMap::PAGE_SHIFT) == PageCache::PAGE_SIZE, "PageMap must use the PageCache page size");
+
+std::atomic<PageMap::Leaf*> PageMap::root_[PageMap::ROOT_SIZE];
+
+namespace {
+// 只在映射新叶子时使用
+std::mutex& leafMutex() {
+    static std::mutex instance;
+    return instance;
+}
+} // namespace
+
+void PageMap::lockAll() {
+    leafMutex().lock();
+}
+
+void PageMap::unlockAll() {
+    leafMutex().unlock();
+}
+
+bool PageMap::set(void* start, size_t numPages, SpanInfo* info) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(start) >> PAGE_SHIFT;
+    for(uintptr_t page = first; page < first + numPages; ++page) {
+        if(page >> (ROOT_BITS + LEAF_BITS)) {
+            return false;
+        }
+        std::atomic<Leaf*>& slot = root_[page >> LEAF_BITS];
+        Leaf* leaf = slot.load(std::memory_order_acquire);
+        if(!leaf) {
+            std::lock_guard<std::mutex> lock(leafMutex());
+            leaf = slot.load(std::memory_order_relaxed);
+            if(!leaf) {
+                // 匿名映射全为零，相当于所有项为nullptr
+                leaf = static_cast<Leaf*>(PageCache::systemAllocLarge(sizeof(Leaf)));
+                if(!leaf) {
+                    return false;
+                }
+                slot.store(leaf, std::memory_order_release);
+            }
+        }
+        leaf->spans[page & (LEAF_SIZE - 1)].store(info, std::memory_order_release);
+    }
+    return true;
+}
+} // namespace MemoryPoolv2
@@ -0,0 +1,96 @@
+#include "PmrResource.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace MemoryPoolv2 {
+void* PoolResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = MemoryPool::allocateAligned(bytes, alignment);
+    if(!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void PoolResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    MemoryPool::deallocateAligned(p, bytes, alignment);
+}
+
+bool PoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    // 无状态，任意两个 PoolResource 都可以互相释放
+    return dynamic_cast<const PoolResource*>(&other) != nullptr;
+}
+
+std::pmr::memory_resource* poolResource() noexcept {
+    static PoolResource instance;
+    return &instance;
+}
+
+MonotonicPoolResource::MonotonicPoolResource(size_t initialSize)
+    : chunks_(nullptr)
+    , cur_(nullptr)
+    , end_(nullptr)
+    , nextChunkSize_(std::min(std::max(initialSize, sizeof(Chunk)), MAX_BYTES))
+    , initialSize_(nextChunkSize_)
+{}
+
+MonotonicPoolResource::~MonotonicPoolResource() {
+    release();
+}
+
+void MonotonicPoolResource::release() {
+    Chunk* chunk = chunks_;
+    while(chunk) {
+        Chunk* next = chunk->next;
+        MemoryPool::deallocate(chunk, chunk->size);
+        chunk = next;
+    }
+    chunks_ = nullptr;
+    cur_ = nullptr;
+    end_ = nullptr;
+    nextChunkSize_ = initialSize_;
+}
+
+void* MonotonicPoolResource::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(cur_) + alignment - 1) & ~(alignment - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(end_);
+    // 写成 bytes > end - aligned，避免 bytes 很大时 aligned + bytes 溢出
+    if(!cur_ || aligned > end || bytes > end - aligned) {
+        allocateChunk(bytes, alignment);
+        aligned = (reinterpret_cast<uintptr_t>(cur_) + alignment - 1) & ~(alignment - 1);
+    }
+    cur_ = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void MonotonicPoolResource::do_deallocate(void*, size_t, size_t) {
+    // 单调资源不单独回收，统一在 release() 中归还
+}
+
+bool MonotonicPoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void MonotonicPoolResource::allocateChunk(size_t bytes, size_t alignment) {
+    // 头部之后按 alignment 对齐最多浪费 alignment - 1 字节
+    size_t needed = sizeof(Chunk) + bytes + alignment - 1;
+    if(needed < bytes) {
+        throw std::bad_alloc();
+    }
+    size_t size = std::max(nextChunkSize_, needed);
+
+    void* memory = MemoryPool::allocate(size);
+    if(!memory) {
+        throw std::bad_alloc();
+    }
+
+    Chunk* chunk = static_cast<Chunk*>(memory);
+    chunk->next = chunks_;
+    chunk->size = size;
+    chunks_ = chunk;
+
+    cur_ = reinterpret_cast<char*>(chunk + 1);
+    end_ = reinterpret_cast<char*>(memory) + size;
+    nextChunkSize_ = std::min(nextChunkSize_ * 2, MAX_BYTES);
+}
+} // namespace MemoryPoolv2
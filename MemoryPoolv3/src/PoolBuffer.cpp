@@ -0,0 +1,19 @@
+#include "PoolBuffer.h"
+#include <algorithm>
+#include <new>
+
+namespace MemoryPoolv2 {
+void PoolBuffer::grow(size_t minCapacity) {
+    if(minCapacity < size_) {
+        throw std::bad_alloc(); // size_ + n 溢出
+    }
+    size_t newCapacity = std::max(minCapacity, capacity_ * 2);
+    void* p = data_ ? MemoryPool::reallocate(data_, capacity_, newCapacity)
+                    : MemoryPool::allocate(newCapacity);
+    if(!p) {
+        throw std::bad_alloc();
+    }
+    data_ = static_cast<char*>(p);
+    capacity_ = MemoryPool::usableSize(newCapacity);
+}
+} // namespace MemoryPoolv2
@@ -1,10 +1,134 @@
 #include "ThreadCache.h"
 #include "CentralCache.h"
-#include <cstdlib>
+#include "PageCache.h"
+#include "PageMap.h"
+#include "Numa.h"
+#include "MetadataAllocator.h"
+#include <pthread.h>
+#include <thread>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace MemoryPoolv2 {
+namespace {
+// 线程本地自由链表的长度阈值，超过时归还一部分给中心缓存
+constexpr size_t MAX_FREE_LIST_LENGTH = 64;
+// 中等对象的链表中每个元素是一整个span，按字节数限制长度
+constexpr size_t MAX_MEDIUM_LIST_BYTES = 1024 * 1024;
+
+size_t maxListLength(size_t index) {
+    size_t size = (index + 1) * ALIGNMENT;
+    if(size > MEDIUM_BYTES) {
+        return std::max(size_t(1), MAX_MEDIUM_LIST_BYTES / size);
+    }
+    return MAX_FREE_LIST_LENGTH;
+}
+
+// 跨线程释放队列中堆积的块数上限
+constexpr size_t MAX_REMOTE_PENDING = 4096;
+// 发往同一所有者的内存块攒够这么多后一次压入，减少对所有者队列的原子操作
+constexpr size_t REMOTE_FREE_BATCH = 32;
+
+// 不小于该大小的内存块使用非临时存储清零
+constexpr size_t NON_TEMPORAL_THRESHOLD = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+
+// 大块内存清零时用非临时存储直接写回内存，不把整块内存读入缓存、挤掉其他热数据
+void clearMemory(void* ptr, size_t size) {
+#if defined(__SSE2__)
+    if(size >= NON_TEMPORAL_THRESHOLD) {
+        char* p = static_cast<char*>(ptr);
+        char* end = p + size;
+        // 首尾不足 16 字节对齐或不足一轮的部分用普通写入
+        char* q = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + 15) & ~uintptr_t(15));
+        memset(p, 0, q - p);
+
+        const __m128i zero = _mm_setzero_si128();
+        for(; q + 64 <= end; q += 64) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(q), zero);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(q + 16), zero);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(q + 32), zero);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(q + 48), zero);
+        }
+        // 非临时存储是弱序的，返回前保证对其他线程可见的顺序
+        _mm_sfence();
+        memset(q, 0, end - q);
+        return;
+    }
+#endif
+    memset(ptr, 0, size);
+}
+
+// 把 first..last 共 count 个内存块的链压入所有者的跨线程释放队列，
+// 所有者已退出或堆积过多时返回false
+bool pushRemote(RemoteFreeQueue* queue, void* first, void* last, size_t count) {
+    if(!queue->alive.load(std::memory_order_acquire)
+       || queue->pending.load(std::memory_order_relaxed) >= MAX_REMOTE_PENDING) {
+        return false;
+    }
+    // 先计数再压入，所有者取走后减去的数量不会超过已经加上的
+    queue->pending.fetch_add(count, std::memory_order_relaxed);
+    void* head = queue->head.load(std::memory_order_relaxed);
+    do {
+        *reinterpret_cast<void**>(last) = head;
+    } while(!queue->head.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+    return true;
+}
+
+// 退出线程的队列放入回收池供新线程复用，不释放：
+// 其他线程可能刚通过 alive 检查，仍会压入内存块，由复用该队列的线程取走
+struct RemoteQueuePool {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    RemoteFreeQueue* freeList = nullptr;
+};
+
+RemoteQueuePool& remoteQueuePool() {
+    static RemoteQueuePool instance;
+    return instance;
+}
+
+RemoteFreeQueue* takeRemoteQueue() {
+    RemoteQueuePool& pool = remoteQueuePool();
+    while(pool.lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    RemoteFreeQueue* queue = pool.freeList;
+    if(queue) {
+        pool.freeList = queue->nextFree;
+    }
+    pool.lock.clear(std::memory_order_release);
+
+    if(!queue) {
+        void* memory = MetadataArena::allocate(sizeof(RemoteFreeQueue));
+        if(!memory) {
+            return nullptr;
+        }
+        queue = new (memory) RemoteFreeQueue{{nullptr}, {0}, {false}, nullptr};
+    }
+    return queue;
+}
+
+void recycleRemoteQueue(RemoteFreeQueue* queue) {
+    RemoteQueuePool& pool = remoteQueuePool();
+    while(pool.lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    queue->nextFree = pool.freeList;
+    pool.freeList = queue;
+    pool.lock.clear(std::memory_order_release);
+}
+
+// 线程退出回调的键，thread_local 的 ThreadCache 平凡析构，只能借助 pthread 键得到退出通知
+pthread_key_t exitKey;
+pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+} // namespace
+
     // 处理size==0的请求：至少分配一个对齐大小（如8字节）。
-    // 大于MAX_BYTES的请求直接通过malloc分配。
+    // 大于MAX_BYTES的请求交给页缓存按页分配。
     // 否则，尝试从线程缓存取内存：
     // 若线程缓存有可用内存，取出一个内存块返回。
     // 若没有，则调用fetchFromCentralCache从中心缓存批量获取内存。
@@ -16,8 +140,8 @@ namespace MemoryPoolv2 {
         }
 
         if(size > MAX_BYTES) {
-            // 大对象直接从系统分配
-            return malloc(size);
+            // 大对象优先复用页缓存中空闲的span，只有超过 MMAP_THRESHOLD 的才单独映射
+            return PageCache::getInstance().allocateLarge(size);
         }
 
         size_t alignedSize = SizeClass::roundUp(size);
@@ -41,16 +165,289 @@ namespace MemoryPoolv2 {
         return fetchFromCentralCache(index);
     }
 
+    // 与 CentralCache 切分span的方式一致：
+    // 一个span只能切出一个块的大小类，块独占整个span（超过 SPAN_PAGES 页的块即按页取整）；
+    // 大对象按页映射。释放时按不超过可用大小的任意大小归还，进入的大小类都不会大于块的实际容量
+    size_t ThreadCache::usableSize(size_t size) {
+        size = SizeClass::roundUp(std::max(size, ALIGNMENT));
+        if(size > MAX_BYTES) {
+            return (size + PageCache::PAGE_SIZE - 1) & ~(PageCache::PAGE_SIZE - 1);
+        }
+        size_t index = SizeClass::getIndex(size);
+        if(CentralCache::classSpanBlocks(index) == 1) {
+            return CentralCache::classSpanPages(index) * PageCache::PAGE_SIZE;
+        }
+        return size;
+    }
+
+    // 大小类内存块从页对齐的span中按块大小连续切分，独占span的内存块和大对象从页起始处开始，
+    // 块大小是 alignment 的倍数且 alignment 不超过页大小时，块地址天然对齐
+    void* ThreadCache::allocateAligned(size_t size, size_t alignment) {
+        if(alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            return nullptr;
+        }
+        if(alignment <= ALIGNMENT) {
+            return allocate(size);
+        }
+        if(size > SIZE_MAX - alignment) {
+            return nullptr;
+        }
+        // size 为 0 时也要按对齐取整，否则会落到 ALIGNMENT 大小类
+        size = (std::max(size, size_t(1)) + alignment - 1) & ~(alignment - 1);
+
+        if(alignment <= PageCache::PAGE_SIZE) {
+            return allocate(size);
+        }
+        if(size > PageCache::MMAP_THRESHOLD) {
+            return PageCache::systemAllocLargeAligned(size, alignment);
+        }
+        size_t numPages = size / PageCache::PAGE_SIZE;
+        return PageCache::getInstance().allocateSpanAligned(numPages, alignment);
+    }
+
+    // 按与 allocateAligned 相同的规则找到内存块的来源
+    void ThreadCache::deallocateAligned(void* ptr, size_t size, size_t alignment) {
+        if(!ptr) {
+            return;
+        }
+        if(alignment <= ALIGNMENT) {
+            deallocate(ptr, size);
+            return;
+        }
+        size = (std::max(size, size_t(1)) + alignment - 1) & ~(alignment - 1);
+
+        if(alignment <= PageCache::PAGE_SIZE || size > MAX_BYTES) {
+            deallocate(ptr, size);
+            return;
+        }
+        PageCache::getInstance().deallocateSpan(ptr, size / PageCache::PAGE_SIZE);
+    }
+
+    void* ThreadCache::allocateZeroed(size_t size) {
+        if(size == 0) {
+            size = ALIGNMENT;
+        }
+
+        if(size > MAX_BYTES) {
+            // 新映射或物理页已交还系统的span全为零；复用的span不逐字节清零，
+            // 而是交还物理页，由内核在实际访问时提供零页
+            bool zeroed = false;
+            void* ptr = PageCache::getInstance().allocateLarge(size, &zeroed);
+            if(ptr && !zeroed) {
+                PageCache::discardPages(ptr, size);
+            }
+            return ptr;
+        }
+
+        // 线程本地链表中的内存块都是回收或切分后写过链表指针的，整体清零
+        size_t index = SizeClass::getIndex(size);
+        if(freeList_[index]) {
+            void* ptr = allocate(size);
+            clearMemory(ptr, size);
+            return ptr;
+        }
+
+        bool zeroed = false;
+        void* ptr = fetchFromCentralCache(index, &zeroed);
+        if(!ptr) {
+            return nullptr;
+        }
+        if(zeroed) {
+            // 来自全零的新span，只有第一个字被用作链表指针
+            *reinterpret_cast<void**>(ptr) = nullptr;
+        } else {
+            clearMemory(ptr, size);
+        }
+        return ptr;
+    }
+
+    // 批量分配：先整段取走线程本地链表，剩余数量较多时直接按所需数量向中心缓存取一条链，
+    // 每个内存块只需一次链表遍历，不必逐个计算大小类和检查链表
+    size_t ThreadCache::allocateBatch(size_t size, size_t n, void** out) {
+        if(size == 0) {
+            size = ALIGNMENT;
+        }
+
+        size_t count = 0;
+        if(size > MAX_BYTES) {
+            for(; count < n; ++count) {
+                out[count] = PageCache::getInstance().allocateLarge(size);
+                if(!out[count]) {
+                    break;
+                }
+            }
+            return count;
+        }
+
+        drainRemoteFrees();
+
+        size_t index = SizeClass::getIndex(size);
+        void* ptr = freeList_[index];
+        while(ptr && count < n) {
+            out[count++] = ptr;
+            ptr = *reinterpret_cast<void**>(ptr);
+        }
+        freeList_[index] = ptr;
+        freeListSize_[index] = ptr ? freeListSize_[index] - std::min(count, freeListSize_[index]) : 0;
+
+        size_t batchNum = getBatchNum(SizeClass::roundUp(size));
+        while(count < n) {
+            size_t want = n - count;
+            // span本地模式下内存块只能来自当前span，逐个走 allocate，用完一个span再换下一个
+            if(want < batchNum || localSpans_) {
+                // 剩余数量不多时按常规路径分配，多取的内存块留在线程缓存
+                void* block = allocate(size);
+                if(!block) {
+                    break;
+                }
+                out[count++] = block;
+                continue;
+            }
+
+            // 返回的链表长度不超过 want，一个新span不够时下一轮继续取
+            void* start = CentralCache::getInstance().fetchRange(index, want, nullptr, remoteQueue());
+            if(!start) {
+                break;
+            }
+            while(start) {
+                out[count++] = start;
+                start = *reinterpret_cast<void**>(start);
+            }
+        }
+        return count;
+    }
+
+    void ThreadCache::reserve(size_t size, size_t count, bool prefault) {
+        if(size > MAX_BYTES) {
+            return; // 大对象不经过缓存
+        }
+        CentralCache::getInstance().reserve(SizeClass::getIndex(size), count, prefault);
+    }
+
+    void ThreadCache::warmUp(size_t size, size_t count) {
+        // span本地模式下链表只保存当前span的内存块，按span整体获取，不需要预热
+        if(size > MAX_BYTES || localSpans_) {
+            return;
+        }
+        size_t index = SizeClass::getIndex(size);
+        // 超过阈值的部分在下次释放时就会被归还，没有意义
+        size_t maxLength = maxListLength(index);
+        if(freeListSize_[index] >= maxLength) {
+            return;
+        }
+        count = std::min(count, maxLength - freeListSize_[index]);
+
+        std::array<void*, MAX_FREE_LIST_LENGTH> blocks;
+        size_t got = allocateBatch(size, count, blocks.data());
+        for(size_t i = got; i-- > 0;) {
+            *reinterpret_cast<void**>(blocks[i]) = freeList_[index];
+            freeList_[index] = blocks[i];
+        }
+        freeListSize_[index] += got;
+    }
+
+    // 批量释放：线程缓存只补到阈值，其余按数组顺序串成一条链一次性归还中心缓存，
+    // 避免逐个插入后反复触发归还。同一批分配的内存块在数组中通常按地址连续，链表顺序保持不变
+    void ThreadCache::deallocateBatch(void** ptrs, size_t n, size_t size) {
+        if(n == 0) {
+            return;
+        }
+        if(size > MAX_BYTES) {
+            for(size_t i = 0; i < n; ++i) {
+                PageCache::getInstance().deallocateLarge(ptrs[i], size);
+            }
+            return;
+        }
+
+        // 跨线程释放的内存块交还所有者，其他节点的内存块与 deallocate 一样直接归还所属节点的中心缓存，
+        // 剩下的在数组前部紧凑排列
+        size_t index = SizeClass::getIndex(size);
+        size_t node = Numa::currentNode();
+        size_t local = 0;
+        for(size_t i = 0; i < n; ++i) {
+            SpanInfo* span = PageMap::get(ptrs[i]);
+            if(span && span->owner != remote_ && span->owner && freeRemote(span->owner, ptrs[i])) {
+                continue;
+            }
+            if(span && span->node != node) {
+                *reinterpret_cast<void**>(ptrs[i]) = nullptr;
+                CentralCache::getInstance(span->node).returnRange(ptrs[i], 1, index);
+                continue;
+            }
+            ptrs[local++] = ptrs[i];
+        }
+        n = local;
+        if(n == 0) {
+            return;
+        }
+
+        if(localSpans_) {
+            for(size_t i = 0; i < n; ++i) {
+                freeLocal(ptrs[i], index, PageMap::get(ptrs[i]), true);
+            }
+            return;
+        }
+        size_t maxLength = maxListLength(index);
+        size_t room = maxLength > freeListSize_[index] ? maxLength - freeListSize_[index] : 0;
+        size_t keep = std::min(n, room);
+
+        if(n > keep) {
+            for(size_t i = keep; i + 1 < n; ++i) {
+                *reinterpret_cast<void**>(ptrs[i]) = ptrs[i + 1];
+            }
+            *reinterpret_cast<void**>(ptrs[n - 1]) = nullptr;
+            CentralCache::getInstance().returnRange(ptrs[keep], n - keep, index);
+        }
+
+        // 倒序插入，保持数组中的顺序
+        for(size_t i = keep; i-- > 0;) {
+            *reinterpret_cast<void**>(ptrs[i]) = freeList_[index];
+            freeList_[index] = ptrs[i];
+        }
+        freeListSize_[index] += keep;
+    }
+
+    // 小对象直接从该节点的中心缓存取一个内存块；切分新span时不记录所有者，
+    // 释放时由释放线程按span所属节点归还，不会进入本线程的跨线程释放队列
+    void* ThreadCache::allocateOnNode(size_t size, size_t node) {
+        if(node >= Numa::nodeCount() || node == Numa::currentNode()) {
+            return allocate(size);
+        }
+        if(size == 0) {
+            size = ALIGNMENT;
+        }
+        if(size > MAX_BYTES) {
+            return PageCache::getInstance(node).allocateLarge(size);
+        }
+        return CentralCache::getInstance(node).fetchRange(SizeClass::getIndex(size), 1);
+    }
+
     // 回收 用户释放的内存块。
     // 将释放的内存块插入到线程本地缓存中（即线程本地自由链表）。
     // 当线程缓存中的内存块超过阈值时，将多余的内存归还给中心缓存（CentralCache），以便平衡整体内存使用效率。
     void ThreadCache::deallocate(void* ptr, size_t size) {
         if(size > MAX_BYTES) {
-            free(ptr);
+            PageCache::getInstance().deallocateLarge(ptr, size);
+            return;
+        }
+
+        // 其他线程切分的span中的内存块交还给所有者，避免内存向只释放不分配的线程聚集
+        SpanInfo* span = PageMap::get(ptr);
+        if(span && span->owner != remote_ && span->owner && freeRemote(span->owner, ptr)) {
             return;
         }
 
         size_t index = SizeClass::getIndex(size);
+        // 其他节点的内存块（allocateOnNode 分配）直接归还所属节点的中心缓存，不留在本线程的自由链表中
+        if(span && span->node != Numa::currentNode()) {
+            *reinterpret_cast<void**>(ptr) = nullptr;
+            CentralCache::getInstance(span->node).returnRange(ptr, 1, index);
+            return;
+        }
+        if(localSpans_) {
+            freeLocal(ptr, index, span, true);
+            return;
+        }
 
         // 插入到线程本地自由链表
         // freeList_[index] --> 原头节点0x2000 --> 0x3000 --> nullptr
@@ -72,11 +469,50 @@ namespace MemoryPoolv2 {
         }
     }
 
+    void* ThreadCache::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        if(!ptr) {
+            return allocate(newSize);
+        }
+        if(newSize == 0) {
+            deallocate(ptr, oldSize);
+            return nullptr;
+        }
+
+        if(oldSize > MAX_BYTES && newSize > MAX_BYTES) {
+            if(void* result = PageCache::getInstance().reallocateLarge(ptr, oldSize, newSize)) {
+                return result;
+            }
+        }
+
+        if(oldSize <= MAX_BYTES && newSize <= MAX_BYTES) {
+            // 同一大小类的内存块大小相同，调用方之后按 newSize 释放也会回到同一链表
+            if(SizeClass::getIndex(oldSize) == SizeClass::getIndex(newSize)) {
+                return ptr;
+            }
+
+            // 超过 SPAN_PAGES 页的内存块独占一个span，可以原地扩大或缩小并改为 newSize 的大小类，
+            // 之后按 newSize 释放时回到该大小类
+            constexpr size_t SPAN_BYTES = CentralCache::SPAN_PAGES * PageCache::PAGE_SIZE;
+            if(oldSize > SPAN_BYTES && newSize > SPAN_BYTES
+               && CentralCache::getInstance().resizeBlock(ptr, SizeClass::getIndex(newSize))) {
+                return ptr;
+            }
+        }
+
+        // 无法原地调整，分配新块并拷贝
+        void* newPtr = allocate(newSize);
+        if(!newPtr) {
+            return nullptr;
+        }
+        memcpy(newPtr, ptr, std::min(oldSize, newSize));
+        deallocate(ptr, oldSize);
+        return newPtr;
+    }
+
     // 判断是否需要将内存回收给中心缓存
     bool ThreadCache::shouldReturnToCentralCache(size_t index) {
         // 设定阈值，例如：当自由链表的大小超过一定数量时
-        size_t threshold = 64;
-        return (freeListSize_[index] > threshold);
+        return (freeListSize_[index] > maxListLength(index));
     }
 
     // 线程缓存（本地链表）为空或不足时
@@ -86,31 +522,241 @@ namespace MemoryPoolv2 {
     // 从中心缓存批量取内存块
     // ↓
     // 取出一个内存块返回，其余保存在本地
-    void* ThreadCache::fetchFromCentralCache(size_t index) {
+    void* ThreadCache::fetchFromCentralCache(size_t index, bool* zeroed) {
+        // 先取回其他线程释放的内存块，够用时不必访问中心缓存
+        drainRemoteFrees();
+        if(void* ptr = freeList_[index]) {
+            --freeListSize_[index];
+            freeList_[index] = *reinterpret_cast<void**>(ptr);
+            if(zeroed) {
+                *zeroed = false;
+            }
+            return ptr;
+        }
+        if(localSpans_) {
+            return fetchLocalSpan(index, zeroed);
+        }
+
         size_t size = (index + 1) * ALIGNMENT; // 计算实际大小
         // 根据对象内存大小计算批量获取的数量
         size_t batchNum = getBatchNum(size);
-        // 从中心缓存批量获取内存
-        void* start = CentralCache::getInstance().fetchRange(index, batchNum);
+        // 从中心缓存批量获取内存，新切分的span记在本线程名下
+        void* start = CentralCache::getInstance().fetchRange(index, batchNum, zeroed, remoteQueue());
         if(!start) {
             return nullptr; // 中心缓存没有可用内存
         }
 
-        // 更新自由链表大小
-        // 增加对应大小类的自由链表大小
-        freeListSize_[index] += batchNum;
-
         // 取一个返回，其余放入线程本地自由链表
         void* result = start;
-        if(batchNum > 1) {
-            // 将start的下一个节点地址存入freeList_[index]
-            freeList_[index] = *reinterpret_cast<void**>(start);
+        // 将start的下一个节点地址存入freeList_[index]
+        freeList_[index] = *reinterpret_cast<void**>(start);
+
+        // 更新自由链表大小
+        // 中心缓存中的span不够时取到的块数可能少于 batchNum，按实际放入本地的块数计数；
+        // 计数偏大会让 returnToCentralCache 找不到分割点，内存块一直留在线程缓存中
+        size_t count = 0;
+        for(void* block = freeList_[index]; block; block = *reinterpret_cast<void**>(block)) {
+            ++count;
         }
+        freeListSize_[index] += count;
 
         return result;
     }
 
 
+    RemoteFreeQueue* ThreadCache::remoteQueue() {
+        if(remote_) {
+            return remote_;
+        }
+        RemoteFreeQueue* queue = takeRemoteQueue();
+        if(!queue) {
+            return nullptr; // 没有队列时新span不记录所有者
+        }
+        queue->alive.store(true, std::memory_order_release);
+        // 先设置 remote_：pthread_setspecific 可能分配内存并重入内存池
+        remote_ = queue;
+
+        pthread_once(&exitKeyOnce, [] {
+            pthread_key_create(&exitKey, &ThreadCache::onThreadExit);
+        });
+        pthread_setspecific(exitKey, this);
+        return queue;
+    }
+
+    bool ThreadCache::freeRemote(RemoteFreeQueue* owner, void* ptr) {
+        if(!owner->alive.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if(!remote_) {
+            remoteQueue(); // 注册线程退出回调，退出时压出攒下的内存块
+        }
+        if(owner != pendingOwner_) {
+            flushRemoteFrees();
+            pendingOwner_ = owner;
+            pendingTail_ = ptr;
+        }
+        *reinterpret_cast<void**>(ptr) = pendingHead_;
+        pendingHead_ = ptr;
+        if(++pendingCount_ >= REMOTE_FREE_BATCH) {
+            flushRemoteFrees();
+        }
+        return true;
+    }
+
+    void ThreadCache::flushRemoteFrees() {
+        if(pendingCount_ == 0) {
+            return;
+        }
+        if(!pushRemote(pendingOwner_, pendingHead_, pendingTail_, pendingCount_)) {
+            // 所有者已退出或来不及取走，改为本地回收
+            *reinterpret_cast<void**>(pendingTail_) = nullptr;
+            insertRemoteBlocks(pendingHead_);
+        }
+        pendingOwner_ = nullptr;
+        pendingHead_ = nullptr;
+        pendingTail_ = nullptr;
+        pendingCount_ = 0;
+    }
+
+    void ThreadCache::drainRemoteFrees() {
+        flushRemoteFrees();
+        if(!remote_ || !remote_->head.load(std::memory_order_relaxed)) {
+            return;
+        }
+        void* block = remote_->head.exchange(nullptr, std::memory_order_acquire);
+        remote_->pending.fetch_sub(insertRemoteBlocks(block), std::memory_order_relaxed);
+    }
+
+    size_t ThreadCache::insertRemoteBlocks(void* block) {
+        size_t count = 0;
+        while(block) {
+            void* next = *reinterpret_cast<void**>(block);
+            // 只有记录了所有者的span中的内存块会走跨线程释放
+            SpanInfo* span = PageMap::get(block);
+            freeLocal(block, span->index, span, false);
+            block = next;
+            ++count;
+        }
+        return count;
+    }
+
+    void ThreadCache::freeLocal(void* ptr, size_t index, SpanInfo* span, bool trim) {
+        if(localSpans_ && span && span != localSpans_[index]) {
+            *reinterpret_cast<void**>(ptr) = nullptr;
+            CentralCache::getInstance().returnRange(ptr, 1, index);
+            return;
+        }
+        *reinterpret_cast<void**>(ptr) = freeList_[index];
+        freeList_[index] = ptr;
+        ++freeListSize_[index];
+        // span本地模式下链表中只有当前span的内存块，数量不超过span的容量，不必归还
+        if(trim && !localSpans_ && shouldReturnToCentralCache(index)) {
+            returnToCentralCache(freeList_[index], (index + 1) * ALIGNMENT);
+        }
+    }
+
+    void* ThreadCache::fetchLocalSpan(size_t index, bool* zeroed) {
+        // 先创建队列：其中可能分配内存并重入内存池
+        RemoteFreeQueue* owner = remoteQueue();
+        CentralCache& central = CentralCache::getInstance();
+
+        // 本地链表已空，当前span中的内存块都已分配出去或归还到了span中
+        if(localSpans_[index]) {
+            central.releaseSpan(localSpans_[index]);
+            localSpans_[index] = nullptr;
+        }
+
+        void* blocks = nullptr;
+        size_t count = 0;
+        SpanInfo* span = central.acquireSpan(index, &blocks, &count, zeroed, owner);
+        if(!span) {
+            return nullptr;
+        }
+        localSpans_[index] = span;
+        freeList_[index] = *reinterpret_cast<void**>(blocks);
+        freeListSize_[index] = count - 1;
+        return blocks;
+    }
+
+    void ThreadCache::lockAll() {
+        RemoteQueuePool& pool = remoteQueuePool();
+        while(pool.lock.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void ThreadCache::unlockAll() {
+        remoteQueuePool().lock.clear(std::memory_order_release);
+    }
+
+    void ThreadCache::setSpanLocal(bool enable) {
+        if(enable == (localSpans_ != nullptr)) {
+            return;
+        }
+        if(!enable) {
+            releaseLocalSpans();
+            return;
+        }
+        void* table = PageCache::systemAllocLarge(FREE_LIST_SIZE * sizeof(SpanInfo*));
+        if(!table) {
+            return;
+        }
+        // 注册线程退出回调，退出时交还当前span
+        remoteQueue();
+        // 已缓存的内存块来自各处，先全部归还，之后的分配都来自当前span
+        drainRemoteFrees();
+        returnAllToCentralCache();
+        localSpans_ = static_cast<SpanInfo**>(table);
+    }
+
+    void ThreadCache::returnAllToCentralCache() {
+        for(size_t index = 0; index < FREE_LIST_SIZE; ++index) {
+            if(freeList_[index]) {
+                CentralCache::getInstance().returnRange(freeList_[index], freeListSize_[index], index);
+                freeList_[index] = nullptr;
+                freeListSize_[index] = 0;
+            }
+        }
+    }
+
+    void ThreadCache::releaseLocalSpans() {
+        // 链表中的内存块先回到各自的span，再交还span
+        returnAllToCentralCache();
+        SpanInfo** table = localSpans_;
+        localSpans_ = nullptr;
+        for(size_t index = 0; index < FREE_LIST_SIZE; ++index) {
+            if(table[index]) {
+                CentralCache::getInstance().releaseSpan(table[index]);
+            }
+        }
+        PageCache::systemFreeLarge(table, FREE_LIST_SIZE * sizeof(SpanInfo*));
+    }
+
+    void ThreadCache::releaseAll() {
+        flushRemoteFrees();
+        RemoteFreeQueue* queue = remote_;
+        if(!queue) {
+            return;
+        }
+        queue->alive.store(false, std::memory_order_release);
+        drainRemoteFrees();
+        remote_ = nullptr;
+
+        // 线程退出后本地链表和当前span无法再被使用，全部归还中心缓存
+        if(localSpans_) {
+            releaseLocalSpans();
+        } else {
+            returnAllToCentralCache();
+        }
+        // 退出线程用过的大小类之后可能再没有活动，顺带归还各大小类中空闲太久的span
+        CentralCache::getInstance().trimEmptyClasses();
+        recycleRemoteQueue(queue);
+    }
+
+    void ThreadCache::onThreadExit(void* cache) {
+        static_cast<ThreadCache*>(cache)->releaseAll();
+    }
+
     // 当线程本地缓存(ThreadCache)中的自由链表长度超过一定阈值时：
     // 保留一部分内存在线程本地缓存，以便快速满足后续请求。
     // 将多余的内存批量归还给中心缓存(CentralCache) ，避免线程缓存占用过多的内存。
@@ -118,9 +764,6 @@ namespace MemoryPoolv2 {
         // 根据大小计算对应的索引
         size_t index = SizeClass::getIndex(size);
 
-        // 获取对齐后的实际块大小
-        size_t alignedSize = SizeClass::roundUp(size);
-
         // 当前自由链表上的内存块数量 (batchNum)
         size_t batchNum = freeListSize_[index];
         // 如果只有一个块，则不归还
@@ -135,7 +778,7 @@ namespace MemoryPoolv2 {
         // 将内存块串成链表
         char* current = static_cast<char*>(start);
 
-        // 使用对齐后的大小计算分割点
+        // 按块数找到分割点
         char* splitNode = current;
         // 链表头(0x1000) -> 0x2000 -> 0x3000 -> 0x4000 -> nullptr
         // batchNum = 4, keepNum = 2, returnNum = 2
@@ -180,7 +823,7 @@ namespace MemoryPoolv2 {
 
             // 将剩余的内存块返回给中心缓存
             if(returnNum > 0 && nextNode != nullptr) {
-                CentralCache::getInstance().returnRange(nextNode, returnNum * alignedSize, index);
+                CentralCache::getInstance().returnRange(nextNode, returnNum, index);
             }
         }
     }